@@ -0,0 +1,220 @@
+/*
+ * Microbenchmarks for every class: streaming push/pop/compute and roll_ndarray() over 2-d arrays.
+ * sweeps dtypes, windows, NaN densities, storage orders and axes, and prints one CSV row per measurement:
+ *   class,dtype,op,window,nan_fraction,layout,axis,threads,elements,ns_per_element,gb_per_s
+ * gb_per_s counts the array once (sizeof(value_type) per element). each case runs 'repeats' times, the best is kept.
+ *
+ * usage: benchmark [--quick] [--filter <substring of class name>] [--threads <n>] [--repeats <n>]
+ * */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <utility>
+#include <cstring>
+#include "../src/rolling_statistics.hpp"
+
+
+struct Config{
+    size_t num_elements = 1 << 20;
+    size_t num_threads = 1;  // roll_ndarray() is also run on this many threads if > 1
+    size_t repeats = 3;
+    std::string filter;
+    std::vector<size_t> windows = {10, 100, 1000};
+    std::vector<double> nan_fractions = {0.0, 0.1};
+};
+
+
+struct Timer{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+
+void report(const std::string& class_name, const std::string& dtype, const std::string& op, size_t window, double nan_fraction,
+            const std::string& layout, int axis, size_t num_threads, size_t num_elements, size_t element_size, double seconds) {
+    std::cout << class_name << ',' << dtype << ',' << op << ',' << window << ',' << nan_fraction << ','
+              << layout << ',' << axis << ',' << num_threads << ',' << num_elements << ','
+              << seconds * 1e9 / static_cast<double>(num_elements) << ','
+              << static_cast<double>(num_elements * element_size) / seconds / 1e9 << std::endl;
+}
+
+
+template <typename D>
+std::vector<D> make_data(size_t n, double nan_fraction, unsigned seed) {
+    /* random walk steps with some repeated values, so that ranks, streaks and bins are not degenerate. */
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> normal(0, 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<D> data(n);
+    for (size_t i = 0; i != n; ++i) {
+        data[i] = uniform(gen) < nan_fraction ? static_cast<D>(NAN) : static_cast<D>(std::round(normal(gen) * 100) / 100);
+    }
+    return data;
+}
+
+
+template <typename D>
+std::vector<std::pair<std::string, std::unique_ptr<RS::RollingStatistics<D>>>> make_prototypes() {
+    /* variants that share a class name get a suffix. */
+    typedef std::unique_ptr<RS::RollingStatistics<D>> Ptr;
+    std::vector<std::pair<std::string, Ptr>> prototypes;
+    prototypes.emplace_back("RollingMean", Ptr(new RS::RollingMean<D>()));
+    prototypes.emplace_back("RollingMean<compressed>", Ptr(new RS::RollingMean<D, RS::CompressedQueue<D>>()));
+    prototypes.emplace_back("RollingVariance", Ptr(new RS::RollingVariance<D>()));
+    prototypes.emplace_back("RollingSkewness", Ptr(new RS::RollingSkewness<D>()));
+    prototypes.emplace_back("RollingZScore", Ptr(new RS::RollingZScore<D>()));
+    prototypes.emplace_back("RollingMax", Ptr(new RS::RollingMax<D>()));
+    prototypes.emplace_back("RollingMax<compressed>", Ptr(new RS::RollingMax<D, RS::CompressedQueue<D>>()));
+    prototypes.emplace_back("RollingMin", Ptr(new RS::RollingMin<D>()));
+    prototypes.emplace_back("RollingRank", Ptr(new RS::RollingRank<D>()));
+    prototypes.emplace_back("RollingOrderStatistics", Ptr(new RS::RollingOrderStatistics<D>(0.5, true, true)));
+    prototypes.emplace_back("RollingStreak", Ptr(new RS::RollingStreak<D>()));
+    prototypes.emplace_back("RollingMaxStreak", Ptr(new RS::RollingMaxStreak<D>()));
+    prototypes.emplace_back("RollingCountAbove", Ptr(new RS::RollingCountAbove<D>(0)));
+    prototypes.emplace_back("RollingCountAbove<dynamic>", Ptr(new RS::RollingCountAbove<D>(0, true, true)));
+    prototypes.emplace_back("RollingFractionAbove", Ptr(new RS::RollingFractionAbove<D>(0)));
+    prototypes.emplace_back("RollingEntropy", Ptr(new RS::RollingEntropy<D>(16, -3, 3)));
+    return prototypes;
+}
+
+
+template <typename D>
+void bench_streaming(RS::RollingStatistics<D>& rs, const std::string& name, const std::string& dtype, const std::vector<D>& data,
+                     size_t window, double nan_fraction, const Config& config) {
+    double best = 1e300;
+    volatile D sink = 0;
+    for (size_t r = 0; r != config.repeats; ++r) {
+        rs.clear();
+        Timer timer;
+        for (size_t i = 0; i != data.size(); ++i) {
+            rs.push(data[i]);
+            if (rs.size() > window) { rs.pop(); }
+            sink = rs.compute();
+        }
+        best = std::min(best, timer.seconds());
+    }
+    (void)sink;
+    report(name, dtype, "push_pop_compute", window, nan_fraction, "-", -1, 1, data.size(), sizeof(D), best);
+}
+
+
+template <typename D>
+void bench_roll_ndarray(RS::RollingStatistics<D>& rs, const std::string& name, const std::string& dtype, const std::vector<D>& data,
+                        size_t window, double nan_fraction, const Config& config) {
+    /* 64 columns of data.size() / 64 rows, in C and Fortran order, rolled along either axis. */
+    std::vector<size_t> shape = {data.size() / 64, 64};
+    std::vector<D> arr(shape[0] * shape[1]);
+    std::vector<size_t> thread_counts = {1};
+    if (config.num_threads > 1) { thread_counts.push_back(config.num_threads); }
+    for (int order = 0; order != 2; ++order) {
+        std::vector<size_t> strides = order == 0 ? std::vector<size_t>{shape[1], 1} : std::vector<size_t>{1, shape[0]};
+        for (int axis = 0; axis != 2; ++axis) {
+            for (size_t t = 0; t != thread_counts.size(); ++t) {
+                double best = 1e300;
+                for (size_t r = 0; r != config.repeats; ++r) {
+                    std::copy(data.begin(), data.begin() + arr.size(), arr.begin());
+                    Timer timer;
+                    rs.roll_ndarray(arr.data(), shape, axis, window, 1, strides, thread_counts[t]);
+                    best = std::min(best, timer.seconds());
+                }
+                report(name, dtype, "roll_ndarray", window, nan_fraction, order == 0 ? "C" : "F", axis, thread_counts[t],
+                       arr.size(), sizeof(D), best);
+            }
+        }
+    }
+}
+
+
+template <typename D>
+void bench_all(const std::string& dtype, const Config& config) {
+    std::vector<std::pair<std::string, std::unique_ptr<RS::RollingStatistics<D>>>> prototypes = make_prototypes<D>();
+    for (size_t f = 0; f != config.nan_fractions.size(); ++f) {
+        std::vector<D> data = make_data<D>(config.num_elements, config.nan_fractions[f], 42);
+        for (size_t p = 0; p != prototypes.size(); ++p) {
+            const std::string& name = prototypes[p].first;
+            if (name.find(config.filter) == std::string::npos) { continue; }
+            for (size_t w = 0; w != config.windows.size(); ++w) {
+                bench_streaming(*prototypes[p].second, name, dtype, data, config.windows[w], config.nan_fractions[f], config);
+                bench_roll_ndarray(*prototypes[p].second, name, dtype, data, config.windows[w], config.nan_fractions[f], config);
+            }
+        }
+    }
+}
+
+
+template <typename T, class Class>
+void bench_bits(const std::string& dtype, const Config& config) {
+    /* the bit-packed classes stream T and roll into a separate float array. */
+    Class rs;
+    if (Class::name.find(config.filter) == std::string::npos) { return; }
+    std::mt19937 gen(42);
+    size_t num_elements = config.num_elements;
+    std::unique_ptr<T[]> data(new T[num_elements]);  // not std::vector, which packs bool
+    for (size_t i = 0; i != num_elements; ++i) {
+        data[i] = static_cast<T>(gen() % (std::is_same<T, bool>::value ? 2 : 256));
+    }
+    std::vector<size_t> shape = {num_elements / 64, 64};
+    std::vector<float> out(shape[0] * shape[1]);
+    for (size_t w = 0; w != config.windows.size(); ++w) {
+        size_t window = config.windows[w];
+        double best = 1e300;
+        volatile double sink = 0;
+        for (size_t r = 0; r != config.repeats; ++r) {
+            rs.clear();
+            Timer timer;
+            for (size_t i = 0; i != num_elements; ++i) {
+                rs.push(data[i]);
+                if (rs.size() > window) { rs.pop(); }
+                sink = rs.compute();
+            }
+            best = std::min(best, timer.seconds());
+        }
+        (void)sink;
+        report(Class::name, dtype, "push_pop_compute", window, 0, "-", -1, 1, num_elements, sizeof(T), best);
+        for (int order = 0; order != 2; ++order) {
+            std::vector<size_t> strides = order == 0 ? std::vector<size_t>{shape[1], 1} : std::vector<size_t>{1, shape[0]};
+            for (int axis = 0; axis != 2; ++axis) {
+                best = 1e300;
+                for (size_t r = 0; r != config.repeats; ++r) {
+                    Timer timer;
+                    rs.roll_ndarray(data.get(), out.data(), shape, axis, window, 1, strides, strides);
+                    best = std::min(best, timer.seconds());
+                }
+                report(Class::name, dtype, "roll_ndarray", window, 0, order == 0 ? "C" : "F", axis, 1, out.size(), sizeof(T), best);
+            }
+        }
+    }
+}
+
+
+int main(int argc, char** argv) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            config.num_elements = 1 << 16;
+            config.repeats = 1;
+        }
+        else if (arg == "--filter" && i + 1 < argc) { config.filter = argv[++i]; }
+        else if (arg == "--threads" && i + 1 < argc) { config.num_threads = std::stoul(argv[++i]); }
+        else if (arg == "--repeats" && i + 1 < argc) { config.repeats = std::max<size_t>(1, std::stoul(argv[++i])); }
+        else {
+            std::cerr << "usage: " << argv[0] << " [--quick] [--filter <class>] [--threads <n>] [--repeats <n>]" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "class,dtype,op,window,nan_fraction,layout,axis,threads,elements,ns_per_element,gb_per_s" << std::endl;
+    bench_all<float>("float32", config);
+    bench_all<double>("float64", config);
+    bench_bits<bool, RS::RollingBitCount<bool>>("bool", config);
+    bench_bits<bool, RS::RollingBitMean<bool>>("bool", config);
+    bench_bits<uint8_t, RS::RollingBitSum<uint8_t>>("uint8", config);
+    return 0;
+}
@@ -0,0 +1,191 @@
+"""
+Benchmarks rolling_statistics_py against pandas, bottleneck and NumPy on identical arrays.
+
+The default scenario is the one from usage_example_python.py: 20 days x 240 minutes x 5000 stocks in float32,
+rolled along the minutes (axis=1) with window=5 and min_periods=3. Baselines that are not installed are skipped.
+Every case runs in a fresh child process, so the reported peak memory is the growth of the maximum resident set
+size during that case alone, on top of the input array. nan_count and checksum of the outputs agree where the
+semantics match: bottleneck's move_rank is normalized to [-1, 1], pandas' skew is bias-corrected, and the NumPy
+baseline only yields full windows.
+
+usage: python benchmark_python.py [--shape 20 240 5000] [--window 5] [--min-periods 3] [--threads 1]
+                                  [--repeats 3] [--stats mean var max ...] [--csv results.csv]
+"""
+
+import argparse
+import csv
+import multiprocessing
+import sys
+import time
+
+import numpy as np
+
+try:
+    import resource
+except ImportError:  # Windows
+    resource = None
+
+import rolling_statistics_py as rsp
+
+
+def peak_rss_mb():
+    if resource is None:
+        return float('nan')
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return peak / 2 ** 20 if sys.platform == 'darwin' else peak / 2 ** 10  # bytes on macOS, KiB on Linux
+
+
+def make_array(shape, seed=0):
+    # generated in float32 directly, so no float64 temporary inflates the memory baseline.
+    return np.random.default_rng(seed).standard_normal(shape, dtype=np.float32)
+
+
+# each runner takes (arr, axis, window, min_periods, threads) and returns the rolled array.
+# rsp rolls inplace, so it works on a copy, which is part of its cost and of its memory.
+
+RSP_CLASSES = {
+    'mean': lambda: rsp.RollingMean_float(),
+    'var': lambda: rsp.RollingVariance_float(),
+    'skew': lambda: rsp.RollingSkewness_float(),
+    'max': lambda: rsp.RollingMax_float(),
+    'min': lambda: rsp.RollingMin_float(),
+    'median': lambda: rsp.RollingOrderStatistics_float(0.5, True, True),
+    'rank': lambda: rsp.RollingRank_float(),
+}
+
+
+def run_rsp(stat):
+    def run(arr, axis, window, min_periods, threads):
+        out = arr.copy()
+        rsp.roll_ndarray_float(out, RSP_CLASSES[stat](), axis=axis, window=window, min_periods=min_periods,
+                               num_threads=threads)
+        return out
+    return run
+
+
+def run_bottleneck(stat):
+    import bottleneck as bn
+    func = {'mean': bn.move_mean, 'var': bn.move_var, 'max': bn.move_max, 'min': bn.move_min,
+            'median': bn.move_median, 'rank': bn.move_rank}.get(stat)
+    if func is None:
+        return None
+
+    def run(arr, axis, window, min_periods, threads):
+        return func(arr, window, min_count=min_periods, axis=axis)
+    return run
+
+
+def run_pandas(stat):
+    import pandas as pd
+    if stat not in ('mean', 'var', 'skew', 'max', 'min', 'median', 'rank'):
+        return None
+    if stat == 'rank' and not hasattr(pd.Series(dtype=np.float32).rolling(1), 'rank'):  # pandas >= 1.4
+        return None
+
+    def run(arr, axis, window, min_periods, threads):
+        # pandas rolls the rows of a 2-d frame, so the rolling axis is moved first and the others flattened.
+        moved = np.moveaxis(arr, axis, 0)
+        frame = pd.DataFrame(moved.reshape(moved.shape[0], -1))
+        rolling = frame.rolling(window, min_periods=min_periods)
+        if stat == 'var':
+            result = rolling.var(ddof=0)
+        elif stat == 'rank':
+            result = rolling.rank(method='min') - 1  # 0-based like RollingRank
+        else:
+            result = getattr(rolling, stat)()
+        return np.moveaxis(result.to_numpy(dtype=np.float32).reshape(moved.shape), 0, axis)
+    return run
+
+
+def run_numpy(stat):
+    func = {'mean': np.nanmean, 'var': np.nanvar, 'max': np.nanmax, 'min': np.nanmin, 'median': np.nanmedian}.get(stat)
+    if func is None or not hasattr(np.lib.stride_tricks, 'sliding_window_view'):  # numpy >= 1.20
+        return None
+
+    def run(arr, axis, window, min_periods, threads):
+        # full windows only, without min_periods: the output is window - 1 cells shorter along axis.
+        view = np.lib.stride_tricks.sliding_window_view(arr, window, axis=axis)
+        return func(view, axis=-1)
+    return run
+
+
+BACKENDS = {'rolling_statistics_py': run_rsp, 'bottleneck': run_bottleneck, 'pandas': run_pandas, 'numpy': run_numpy}
+
+
+def run_case(backend, stat, args, queue):
+    """ runs in a child process and puts one result row into the queue. """
+    try:
+        runner = BACKENDS[backend](stat)
+    except ImportError:
+        runner = None
+    if runner is None:
+        queue.put(None)
+        return
+    arr = make_array(tuple(args.shape))
+    baseline = peak_rss_mb()
+    times = []
+    out = None
+    try:
+        for _ in range(args.repeats):
+            out = None  # free the previous result before the next run
+            start = time.perf_counter()
+            out = runner(arr, args.axis, args.window, args.min_periods, args.threads)
+            times.append(time.perf_counter() - start)
+    except Exception as e:  # e.g. a baseline too old for these arguments, the other cases still run
+        print('{} {} failed: {!r}'.format(backend, stat, e), file=sys.stderr)
+        queue.put(None)
+        return
+    seconds = min(times)
+    queue.put({
+        'backend': backend,
+        'stat': stat,
+        'shape': 'x'.join(map(str, args.shape)),
+        'axis': args.axis,
+        'window': args.window,
+        'threads': args.threads if backend == 'rolling_statistics_py' else 1,
+        'seconds': seconds,
+        'melems_per_s': arr.size / seconds / 1e6,
+        'gb_per_s': arr.nbytes / seconds / 1e9,
+        'peak_extra_mb': peak_rss_mb() - baseline,
+        'nan_count': int(np.isnan(out).sum()),
+        'checksum': float(np.nansum(out, dtype=np.float64)),
+    })
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--shape', type=int, nargs='+', default=[20, 240, 5000])
+    parser.add_argument('--axis', type=int, default=1)
+    parser.add_argument('--window', type=int, default=5)
+    parser.add_argument('--min-periods', type=int, default=3)
+    parser.add_argument('--threads', type=int, default=1, help='num_threads for rolling_statistics_py')
+    parser.add_argument('--repeats', type=int, default=3)
+    parser.add_argument('--stats', nargs='+', default=list(RSP_CLASSES), choices=list(RSP_CLASSES))
+    parser.add_argument('--backends', nargs='+', default=list(BACKENDS), choices=list(BACKENDS))
+    parser.add_argument('--csv', help='also write the results to this file')
+    args = parser.parse_args()
+
+    context = multiprocessing.get_context('fork' if sys.platform.startswith('linux') else 'spawn')
+    rows = []
+    for stat in args.stats:
+        for backend in args.backends:
+            queue = context.Queue()
+            process = context.Process(target=run_case, args=(backend, stat, args, queue))
+            process.start()
+            row = queue.get()
+            process.join()
+            if row is None:
+                continue
+            rows.append(row)
+            print('{backend:>22} {stat:>7}: {seconds:8.3f} s {melems_per_s:9.1f} Melem/s {gb_per_s:6.2f} GB/s '
+                  '{peak_extra_mb:8.1f} MB peak  nan={nan_count} checksum={checksum:.6g}'.format(**row), flush=True)
+
+    if args.csv and rows:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=list(rows[0]))
+            writer.writeheader()
+            writer.writerows(rows)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,15 @@
+/*
+ * the compiled part of the library: every class for float and double, and the block kernels of every SIMD level.
+ * built as the rolling_statistics_kernels target, which defines RS_COMPILED_KERNELS for itself and its users.
+ * */
+
+#include "rolling_statistics.hpp"
+
+namespace RS {
+
+RS_INSTANTIATE_CLASSES(, float)
+RS_INSTANTIATE_CLASSES(, double)
+RS_INSTANTIATE_KERNELS(, float)
+RS_INSTANTIATE_KERNELS(, double)
+
+}  // namespace RS
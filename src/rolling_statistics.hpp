@@ -25,13 +25,48 @@
 #include <stdexcept>
 #include <cmath>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <queue>
 #include <utility>
 #include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
 #include <unordered_map>
 #include <initializer_list>
+#include <type_traits>
+#include <limits>
+#include <chrono>
 #include <ext/pb_ds/assoc_container.hpp>
 #include <ext/pb_ds/tree_policy.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+/*
+ * runtime SIMD dispatch: the block kernels are compiled for the baseline, AVX2 and AVX-512 (GCC or Clang on x86),
+ * and one instance is picked by CPUID when they are first used, see simd_level(). define RS_NO_SIMD_DISPATCH to
+ * only build the baseline, e.g. for compilers without the target attribute.
+ * */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(RS_NO_SIMD_DISPATCH)
+#define RS_HAS_SIMD_DISPATCH
+#define RS_TARGET_AVX2 __attribute__((target("avx2")))
+#define RS_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#if defined(__GNUC__)
+#define RS_ALWAYS_INLINE __attribute__((always_inline))
+#else
+#define RS_ALWAYS_INLINE
+#endif
+#if defined(RS_LATENCY_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define RS_HAS_RDTSC
+#endif
 
 
 namespace RS{
@@ -49,6 +84,996 @@ template <typename D>
 using order_statistics_tree = __gnu_pbds::tree<D, __gnu_pbds::null_type, std::less_equal<D>, __gnu_pbds::rb_tree_tag, __gnu_pbds::tree_order_statistics_node_update>;
 
 
+/*
+ * binary checkpoint format, shared by all classes:
+ *   magic (uint32) | version (uint16) | sizeof(value_type) (uint8) | class name (uint16 length + bytes)
+ *   | skip_nan (uint8) | num_vals_nan (uint64) | num_vals_notnan (uint64) | class specific payload.
+ * containers are written as a uint64 length followed by their raw contents in one bulk copy.
+ * the format is native-endian, checkpoints are meant to be restored on the same kind of machine.
+ * */
+const uint32_t SERIALIZATION_MAGIC = 0x53535252;  // "RRSS"
+const uint16_t SERIALIZATION_VERSION = 1;
+
+const size_t CACHE_LINE_SIZE = 64;
+const size_t DETERMINISTIC_CHUNK_LENGTH = 1 << 16;  // see RollingStatistics::num_chunks_per_lane()
+
+/*
+ * hot path counters, compiled in with -DRS_ENABLE_INSTRUMENTATION. otherwise objects carry no counters, the
+ * count_*() hooks are empty and instrumentation() returns zeros.
+ * */
+#ifdef RS_ENABLE_INSTRUMENTATION
+const bool INSTRUMENTATION_ENABLED = true;
+#else
+const bool INSTRUMENTATION_ENABLED = false;
+#endif
+
+struct InstrumentationStats{
+    uint64_t num_pushes = 0;
+    uint64_t num_pops = 0;
+    uint64_t num_nans = 0;  // NaNs pushed.
+    uint64_t max_deque_length = 0;  // longest monotonic deque of RollingMax/RollingMin.
+    uint64_t num_tree_ops = 0;  // order statistics tree inserts, erases and queries.
+    uint64_t num_allocations = 0;  // tree nodes and per-worker copies, blocks of std containers are not seen.
+    uint64_t num_lanes = 0;  // lanes, or chunks of lanes, rolled by roll_ndarray().
+    uint64_t lane_nanoseconds = 0;
+    uint64_t max_lane_nanoseconds = 0;
+    void merge(const InstrumentationStats& other) {
+        num_pushes += other.num_pushes;
+        num_pops += other.num_pops;
+        num_nans += other.num_nans;
+        max_deque_length = std::max(max_deque_length, other.max_deque_length);
+        num_tree_ops += other.num_tree_ops;
+        num_allocations += other.num_allocations;
+        num_lanes += other.num_lanes;
+        lane_nanoseconds += other.lane_nanoseconds;
+        max_lane_nanoseconds = std::max(max_lane_nanoseconds, other.max_lane_nanoseconds);
+    }
+};
+
+class SerializationWriter{
+    /* appends plain values and contiguous buffers to a byte string. */
+public:
+    std::string buf;
+    template <typename T>
+    void write(const T& val) {
+        buf.append(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+    template <typename T>
+    void write_array(const T* ptr, size_t n) {
+        write<uint64_t>(n);
+        buf.append(reinterpret_cast<const char*>(ptr), n * sizeof(T));
+    }
+    template <typename T, class Container>
+    void write_container(const Container& c) {
+        /* std::deque is not contiguous, so gather it into one buffer first. */
+        std::vector<T> vals(c.begin(), c.end());
+        write_array(vals.data(), vals.size());
+    }
+    void write_string(const std::string& str) {
+        write<uint16_t>(static_cast<uint16_t>(str.size()));
+        buf.append(str);
+    }
+};
+
+class SerializationReader{
+    /* reads back what SerializationWriter wrote, throws on truncated or malformed input. */
+protected:
+    const char* cur;
+    const char* end;
+    void require(size_t n) {
+        if (static_cast<size_t>(end - cur) < n) {
+            throw std::runtime_error("RS::deserialize: unexpected end of data");
+        }
+    }
+public:
+    SerializationReader(const char* ptr, size_t n): cur(ptr), end(ptr + n) {}
+    template <typename T>
+    T read() {
+        require(sizeof(T));
+        T val;
+        std::memcpy(&val, cur, sizeof(T));
+        cur += sizeof(T);
+        return val;
+    }
+    template <typename T>
+    std::vector<T> read_array() {
+        uint64_t n = read<uint64_t>();
+        if (n > static_cast<uint64_t>(end - cur) / sizeof(T)) {
+            throw std::runtime_error("RS::deserialize: unexpected end of data");
+        }
+        std::vector<T> vals(static_cast<size_t>(n));
+        if (n > 0) { std::memcpy(vals.data(), cur, static_cast<size_t>(n) * sizeof(T)); }
+        cur += static_cast<size_t>(n) * sizeof(T);
+        return vals;
+    }
+    std::string read_string() {
+        uint16_t n = read<uint16_t>();
+        require(n);
+        std::string str(cur, n);
+        cur += n;
+        return str;
+    }
+    bool at_end() const { return cur == end; }
+};
+
+template <typename D>
+const std::deque<D>& underlying_deque(const std::queue<D>& q) {
+    /* std::queue hides its container as a protected member, this exposes it for bulk reads. */
+    struct Access : std::queue<D> {
+        static const std::deque<D>& get(const std::queue<D>& q_) { return q_.*(&Access::c); }
+    };
+    return Access::get(q);
+}
+
+
+/*
+ * memory accounting. the standard containers do not report their blocks, so these are estimates after the
+ * libstdc++ layout: a deque allocates 512 byte chunks and a map of chunk pointers, a tree node holds its value,
+ * a color, three pointers and the subtree size, and every heap block carries MALLOC_OVERHEAD bytes of allocator
+ * bookkeeping. node counts are exact, bytes are typically within a few percent for sliding windows.
+ * */
+const size_t MALLOC_OVERHEAD = 16;
+
+struct MemoryUsage{
+    uint64_t object_bytes = 0;  // the objects themselves, including their InstrumentationStats.
+    uint64_t buffer_bytes = 0;  // capacity of value buffers: deque chunks, vectors, compressed blocks.
+    uint64_t num_nodes = 0;  // order statistics tree nodes.
+    uint64_t node_bytes = 0;
+    uint64_t overhead_bytes = 0;  // deque maps and allocator bookkeeping.
+    uint64_t total() const { return object_bytes + buffer_bytes + node_bytes + overhead_bytes; }
+    void merge(const MemoryUsage& other) {
+        object_bytes += other.object_bytes;
+        buffer_bytes += other.buffer_bytes;
+        num_nodes += other.num_nodes;
+        node_bytes += other.node_bytes;
+        overhead_bytes += other.overhead_bytes;
+    }
+};
+
+template <typename T>
+void add_memory_usage(MemoryUsage& usage, const std::vector<T>& v) {
+    usage.buffer_bytes += v.capacity() * sizeof(T);
+    if (v.capacity() > 0) { usage.overhead_bytes += MALLOC_OVERHEAD; }
+}
+
+template <typename T>
+void add_memory_usage(MemoryUsage& usage, const std::deque<T>& d) {
+    /*
+     * a deque keeps at least one chunk, and its map 2 spare slots, even when empty. a window sliding through it
+     * spans on average size / per_chunk + 1 chunks, as it starts anywhere in the first one.
+     * */
+    size_t per_chunk = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+    size_t num_chunks = (d.size() + per_chunk / 2) / per_chunk + 1;
+    size_t map_size = std::max<size_t>(8, num_chunks + 2);
+    usage.buffer_bytes += num_chunks * per_chunk * sizeof(T);
+    usage.overhead_bytes += map_size * sizeof(T*) + (num_chunks + 1) * MALLOC_OVERHEAD;
+}
+
+template <typename T>
+void add_memory_usage(MemoryUsage& usage, const std::queue<T>& q) {
+    add_memory_usage(usage, underlying_deque(q));
+}
+
+template <typename D>
+void add_memory_usage(MemoryUsage& usage, const order_statistics_tree<D>& tree) {
+    /* one node per value, the header node lives in the tree object. */
+    const size_t node_size = (sizeof(D) + sizeof(bool) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*) + 3 * sizeof(void*) + sizeof(size_t);
+    usage.num_nodes += tree.size();
+    usage.node_bytes += tree.size() * node_size;
+    usage.overhead_bytes += tree.size() * MALLOC_OVERHEAD;
+}
+
+template <class Class>
+void add_contained_memory_usage(MemoryUsage& usage, const Class& obj) {
+    /* for an object inside a container that is counted already: everything but the object itself. */
+    MemoryUsage inner = obj.memory_usage();
+    inner.object_bytes = 0;
+    usage.merge(inner);
+}
+
+
+template <typename D>
+struct FloatBits;
+template <>
+struct FloatBits<float>{ typedef uint32_t type; static const unsigned width_bits = 5; };  // leading zeros / length fields
+template <>
+struct FloatBits<double>{ typedef uint64_t type; static const unsigned width_bits = 6; };
+
+
+template <typename D, size_t BlockSize = 512>
+class CompressedQueue{
+    /*
+     * a FIFO of floating point values with the interface of std::queue, stored XOR-compressed as in Gorilla:
+     * each value is XORed with the previous one, and only the meaningful bits of the result are kept, so slowly
+     * changing series (prices, volumes, running sums) take a fraction of their raw size. values are appended to
+     * the last block and decoded one at a time from the first block as they are popped; a block is freed once
+     * all of its values are popped. random noise does not compress and then costs slightly more than raw storage.
+     * */
+protected:
+    typedef typename FloatBits<D>::type U;
+    static const unsigned NUM_BITS = 8 * sizeof(U);
+    struct Block{
+        std::vector<uint64_t> words;
+        size_t num_bits = 0;
+        size_t count = 0;
+    };
+    struct Cursor{
+        /* state shared by the encoder and the decoder, which must follow the same steps. */
+        U prev = 0;
+        unsigned leading = NUM_BITS + 1;  // window of meaningful bits of the previous XOR, none yet
+        unsigned trailing = 0;
+    };
+    std::deque<Block> blocks;
+    Cursor encoder;  // at the end of the last block
+    Cursor decoder;  // after the front value of the first block
+    size_t read_bit = 0;  // position of the decoder in the first block
+    size_t num_popped = 0;  // values popped from the first block
+    size_t num_vals = 0;
+    D front_val = 0;  // decoded front value, valid if num_vals > 0
+
+    static void write_bits(Block& block, uint64_t val, unsigned n) {
+        /* appends the n lowest bits of val. */
+        if (n == 0) { return; }
+        size_t offset = block.num_bits % 64;
+        if (offset == 0) { block.words.push_back(0); }
+        block.words.back() |= val << offset;
+        if (offset + n > 64) {
+            block.words.push_back(val >> (64 - offset));
+        }
+        block.num_bits += n;
+    }
+    static uint64_t read_bits(const Block& block, size_t& pos, unsigned n) {
+        if (n == 0) { return 0; }
+        size_t offset = pos % 64;
+        uint64_t val = block.words[pos / 64] >> offset;
+        if (offset + n > 64) {
+            val |= block.words[pos / 64 + 1] << (64 - offset);
+        }
+        pos += n;
+        return n == 64 ? val : val & ((static_cast<uint64_t>(1) << n) - 1);
+    }
+    static unsigned count_leading_zeros(U x) {
+        return static_cast<unsigned>(__builtin_clzll(static_cast<uint64_t>(x))) - (64 - NUM_BITS);
+    }
+    static void encode(Block& block, Cursor& cursor, U bits) {
+        if (block.count == 0) {
+            write_bits(block, bits, NUM_BITS);
+            cursor = Cursor();
+        }
+        else {
+            U x = bits ^ cursor.prev;
+            if (x == 0) {
+                write_bits(block, 0, 1);
+            }
+            else {
+                unsigned leading = count_leading_zeros(x);
+                unsigned trailing = static_cast<unsigned>(__builtin_ctzll(static_cast<uint64_t>(x)));
+                leading = std::min(leading, (1u << FloatBits<D>::width_bits) - 1);
+                if (cursor.leading <= NUM_BITS && leading >= cursor.leading && trailing >= cursor.trailing) {
+                    // fits into the previous window
+                    write_bits(block, 1, 2);
+                    write_bits(block, x >> cursor.trailing, NUM_BITS - cursor.leading - cursor.trailing);
+                }
+                else {
+                    unsigned length = NUM_BITS - leading - trailing;
+                    write_bits(block, 3, 2);
+                    write_bits(block, leading, FloatBits<D>::width_bits);
+                    write_bits(block, length - 1, FloatBits<D>::width_bits);
+                    write_bits(block, x >> trailing, length);
+                    cursor.leading = leading;
+                    cursor.trailing = trailing;
+                }
+            }
+        }
+        cursor.prev = bits;
+        ++block.count;
+    }
+    static U decode(const Block& block, size_t index, size_t& pos, Cursor& cursor) {
+        if (index == 0) {
+            cursor = Cursor();
+            cursor.prev = static_cast<U>(read_bits(block, pos, NUM_BITS));
+            return cursor.prev;
+        }
+        if (read_bits(block, pos, 1) == 0) { return cursor.prev; }
+        if (read_bits(block, pos, 1) == 1) {
+            cursor.leading = static_cast<unsigned>(read_bits(block, pos, FloatBits<D>::width_bits));
+            unsigned length = static_cast<unsigned>(read_bits(block, pos, FloatBits<D>::width_bits)) + 1;
+            cursor.trailing = NUM_BITS - cursor.leading - length;
+        }
+        unsigned length = NUM_BITS - cursor.leading - cursor.trailing;
+        cursor.prev ^= static_cast<U>(read_bits(block, pos, length) << cursor.trailing);
+        return cursor.prev;
+    }
+    static D to_value(U bits) {
+        D val;
+        std::memcpy(&val, &bits, sizeof(D));
+        return val;
+    }
+    void decode_front() {
+        front_val = to_value(decode(blocks.front(), num_popped, read_bit, decoder));
+    }
+
+public:
+    typedef D value_type;
+    inline size_t size() const { return num_vals; }
+    inline bool empty() const { return num_vals == 0; }
+    inline D front() const {
+        assert(num_vals > 0);
+        return front_val;
+    }
+    void push(const D& val) {
+        if (blocks.empty() || blocks.back().count == BlockSize) {
+            // a series compresses about as well as it did in the previous block, so reserve that much
+            size_t num_words = blocks.empty() ? 0 : blocks.back().words.size();
+            blocks.push_back(Block());
+            blocks.back().words.reserve(num_words);
+        }
+        U bits;
+        std::memcpy(&bits, &val, sizeof(D));
+        encode(blocks.back(), encoder, bits);
+        if (blocks.back().count == BlockSize) {
+            blocks.back().words.shrink_to_fit();  // a full block never grows again, drop the slack of the doublings
+        }
+        if (num_vals++ == 0) {
+            decode_front();
+        }
+    }
+    void pop() {
+        assert(num_vals > 0);
+        --num_vals;
+        ++num_popped;
+        if (num_popped == blocks.front().count && (blocks.size() > 1 || num_popped == BlockSize)) {
+            blocks.pop_front();
+            read_bit = 0;
+            num_popped = 0;
+        }
+        if (num_vals > 0) {
+            decode_front();
+        }
+    }
+    std::vector<D> values() const {
+        /* decodes the whole window, oldest first. */
+        std::vector<D> vals;
+        vals.reserve(num_vals);
+        for (size_t b = 0; b != blocks.size(); ++b) {
+            size_t pos = 0;
+            Cursor cursor;
+            for (size_t i = 0; i != blocks[b].count; ++i) {
+                U bits = decode(blocks[b], i, pos, cursor);
+                if (b > 0 || i >= num_popped) { vals.push_back(to_value(bits)); }
+            }
+        }
+        return vals;
+    }
+    size_t num_bytes() const {
+        /* bytes held by the compressed blocks. */
+        size_t n = 0;
+        for (size_t b = 0; b != blocks.size(); ++b) {
+            n += blocks[b].words.capacity() * sizeof(uint64_t);
+        }
+        return n;
+    }
+    void add_memory_usage(MemoryUsage& usage) const {
+        /* the compressed words are the buffer, the deque of block headers is overhead. */
+        MemoryUsage headers;
+        RS::add_memory_usage(headers, blocks);
+        usage.buffer_bytes += num_bytes();
+        usage.overhead_bytes += headers.total() + blocks.size() * MALLOC_OVERHEAD;
+    }
+};
+
+
+/*
+ * window containers. the moment and min/max classes take the container of their value history as a template
+ * parameter, std::queue<D> by default or CompressedQueue<D> to save memory. these overloads give both the same
+ * checkpoint format, so a checkpoint can be restored into either.
+ * */
+template <typename D>
+inline const std::deque<D>& window_values(const std::queue<D>& q) { return underlying_deque(q); }
+
+template <typename D, size_t BlockSize>
+inline std::vector<D> window_values(const CompressedQueue<D, BlockSize>& q) { return q.values(); }
+
+template <typename D, size_t BlockSize>
+void add_memory_usage(MemoryUsage& usage, const CompressedQueue<D, BlockSize>& q) { q.add_memory_usage(usage); }
+
+template <class Window>
+void write_window(SerializationWriter& writer, const Window& window) {
+    typedef typename Window::value_type D;
+    writer.write_container<D>(window_values(window));
+}
+
+template <class Window>
+void read_window(SerializationReader& reader, Window& window) {
+    typedef typename Window::value_type D;
+    std::vector<D> vals = reader.read_array<D>();
+    window = Window();
+    for (size_t i = 0; i != vals.size(); ++i) {
+        window.push(vals[i]);
+    }
+}
+
+template <class Window>
+void append_window(Window& window, const Window& other) {
+    /* push the values of other after ours, for merge(). */
+    const auto& vals = window_values(other);
+    for (size_t i = 0; i != vals.size(); ++i) {
+        window.push(vals[i]);
+    }
+}
+
+template <class Window>
+void drop_window_front(Window& window, size_t n) {
+    /* pop the n oldest values, for subtract(). */
+    assert(n <= window.size());
+    for (size_t i = 0; i != n; ++i) {
+        window.pop();
+    }
+}
+
+
+template <typename D>
+class CountingWindow{
+    /*
+     * a window that keeps only the number of its values and the newest one, for partial windows that are merge()d
+     * and subtract()ed as a whole, e.g. the panes of RollingRollup: a moment class on it holds its sums and counts
+     * and no values. single values cannot be popped, except the only one of a window of one (RollingZScore's x_i).
+     * */
+protected:
+    size_t num_vals = 0;
+    D newest = 0;
+public:
+    typedef D value_type;
+    CountingWindow() {}
+    CountingWindow(size_t num_vals_, D newest_): num_vals(num_vals_), newest(newest_) {}
+    inline size_t size() const { return num_vals; }
+    inline bool empty() const { return num_vals == 0; }
+    inline D front() const {
+        assert(num_vals == 1);
+        return newest;
+    }
+    inline D back() const {
+        assert(num_vals > 0);
+        return newest;
+    }
+    void push(const D& val) {
+        ++num_vals;
+        newest = val;
+    }
+    void pop() {
+        assert(num_vals == 1);
+        --num_vals;
+    }
+    void append(const CountingWindow<D>& other) {
+        num_vals += other.num_vals;
+        if (other.num_vals > 0) { newest = other.newest; }
+    }
+    void drop_front(size_t n) {
+        assert(n <= num_vals);
+        num_vals -= n;
+    }
+};
+
+template <typename D>
+void append_window(CountingWindow<D>& window, const CountingWindow<D>& other) { window.append(other); }
+
+template <typename D>
+void drop_window_front(CountingWindow<D>& window, size_t n) { window.drop_front(n); }
+
+template <typename D>
+void add_memory_usage(MemoryUsage&, const CountingWindow<D>&) {}  // held inline
+
+template <typename D>
+void write_window(SerializationWriter& writer, const CountingWindow<D>& window) {
+    writer.write<uint64_t>(window.size());
+    writer.write<D>(window.empty() ? D(0) : window.back());
+}
+
+template <typename D>
+void read_window(SerializationReader& reader, CountingWindow<D>& window) {
+    size_t num_vals = static_cast<size_t>(reader.read<uint64_t>());
+    window = CountingWindow<D>(num_vals, reader.read<D>());
+}
+
+
+/*
+ * NUMA placement for the parallel roll_ndarray(). on machines with several nodes, worker t of T is bound to
+ * node t * num_nodes / T. when the rolled axis is the contiguous one, lanes are contiguous and workers take
+ * contiguous memory ranges, so pages first touched by first_touch() with the same number of workers end up on the
+ * node of the worker that later rolls them. along other axes every lane spans the whole array, and no placement helps.
+ * everything is a no-op on single-node machines and outside Linux.
+ * */
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+    /* parses the sysfs format, e.g. "0-3,8,10-11". */
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range[0] == '\n') { continue; }
+        size_t dash = range.find('-');
+        int first = std::atoi(range.substr(0, dash).c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int cpu = first; cpu <= last; ++cpu) { cpus.push_back(cpu); }
+    }
+    return cpus;
+}
+
+inline std::vector<std::vector<int>> numa_node_cpus() {
+    /* the cpus of every online NUMA node that has any, empty if the topology is unknown. */
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string line;
+    if (!std::getline(online, line)) { return nodes; }
+    std::vector<int> node_ids = parse_cpu_list(line);
+    for (size_t i = 0; i != node_ids.size(); ++i) {
+        std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node_ids[i]) + "/cpulist");
+        if (std::getline(cpulist, line)) {
+            std::vector<int> cpus = parse_cpu_list(line);
+            if (!cpus.empty()) { nodes.push_back(cpus); }
+        }
+    }
+#endif
+    return nodes;
+}
+
+inline void bind_to_numa_node(size_t worker, size_t num_workers) {
+    /* binds the calling thread to the node of 'worker'. failures (e.g. a restricted cpuset) leave it unbound. */
+#ifdef __linux__
+    static const std::vector<std::vector<int>> nodes = numa_node_cpus();
+    if (nodes.size() < 2 || num_workers < 2) { return; }
+    const std::vector<int>& cpus = nodes[worker * nodes.size() / num_workers];
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (size_t i = 0; i != cpus.size(); ++i) {
+        if (cpus[i] < CPU_SETSIZE) { CPU_SET(cpus[i], &cpu_set); }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)worker;
+    (void)num_workers;
+#endif
+}
+
+/*
+ * parallel execution. an Executor runs a fixed number of workers; parallel_for() balances ranges of tasks
+ * across them by work stealing, so that lanes of uneven cost (NaN-heavy, long windows) do not leave cores idle.
+ * */
+class Executor{
+    /*
+     * runs fn(0), ..., fn(num_workers - 1) and returns once all have returned. derive from this to run the
+     * workers on an external thread pool and install it with set_executor(). the workers may run concurrently
+     * or not, parallel_for() finishes either way, since any worker steals whatever the others have not started.
+     * */
+public:
+    virtual ~Executor() {}
+    virtual void run(size_t num_workers, const std::function<void(size_t)>& fn) = 0;
+};
+
+
+class ThreadExecutor : public Executor{
+    /* the default: one std::thread per worker, bound to its NUMA node. a single worker runs on the calling thread. */
+public:
+    void run(size_t num_workers, const std::function<void(size_t)>& fn) {
+        if (num_workers == 1) {
+            fn(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (size_t worker = 0; worker != num_workers; ++worker) {
+            threads.push_back(std::thread([=, &fn]() {
+                bind_to_numa_node(worker, num_workers);
+                fn(worker);
+            }));
+        }
+        for (size_t worker = 0; worker != num_workers; ++worker) {
+            threads[worker].join();
+        }
+    }
+};
+
+
+inline std::shared_ptr<Executor>& executor_instance() {
+    static std::shared_ptr<Executor> instance(new ThreadExecutor());
+    return instance;
+}
+
+inline Executor& get_executor() { return *executor_instance(); }
+
+inline void set_executor(std::shared_ptr<Executor> executor) {
+    /* not thread-safe, install it before rolling anything. nullptr restores the default. */
+    executor_instance() = executor ? executor : std::shared_ptr<Executor>(new ThreadExecutor());
+}
+
+
+class WorkStealingDeque{
+    /*
+     * Chase-Lev deque of task ranges, packed as (begin << 32 | end). the owning worker pushes and pops at the
+     * bottom, other workers steal from the top. the capacity is fixed, which suffices as parallel_for() only
+     * pushes halves of halves, i.e. at most 32 ranges deep at a time.
+     * */
+protected:
+    static const int64_t CAPACITY = 64;
+    std::atomic<int64_t> top;
+    char padding_top[CACHE_LINE_SIZE - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom;
+    char padding_bottom[CACHE_LINE_SIZE - sizeof(std::atomic<int64_t>)];
+    std::atomic<uint64_t> buf[CAPACITY];
+public:
+    WorkStealingDeque(): top(0), bottom(0) {}
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    void push(uint64_t range) {
+        /* owner only. */
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        assert(b - top.load(std::memory_order_acquire) < CAPACITY);
+        buf[b % CAPACITY].store(range, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    bool pop(uint64_t& range) {
+        /* owner only, takes the most recently pushed range. */
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        range = buf[b % CAPACITY].load(std::memory_order_relaxed);
+        if (t == b) {
+            // the last range, race against thieves for it.
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+    bool steal(uint64_t& range) {
+        /* any thread, takes the oldest (and largest) range. */
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) { return false; }
+        range = buf[t % CAPACITY].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+
+inline void parallel_for(size_t num_tasks, size_t num_workers, size_t grain, const std::function<void(size_t, size_t, size_t)>& fn) {
+    /*
+     * calls fn(worker, begin, end) over ranges covering [0, num_tasks) exactly once, on get_executor().
+     * worker w starts on the w-th contiguous share (keeping NUMA locality), and splits any range longer than
+     * grain in halves: it keeps the lower half and exposes the upper half to thieves. idle workers steal.
+     * which worker runs a task never changes the result of roll_ndarray(), so stealing keeps it deterministic.
+     * */
+    assert(num_tasks < (static_cast<uint64_t>(1) << 32));
+    num_workers = std::max<size_t>(1, std::min(num_workers, num_tasks));
+    grain = std::max<size_t>(1, grain);
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+    for (size_t worker = 0; worker != num_workers; ++worker) {
+        deques.push_back(std::unique_ptr<WorkStealingDeque>(new WorkStealingDeque()));
+        uint64_t begin = num_tasks * worker / num_workers;
+        uint64_t end = num_tasks * (worker + 1) / num_workers;
+        if (begin != end) { deques[worker]->push(begin << 32 | end); }
+    }
+    std::atomic<size_t> num_remaining(num_tasks);
+    get_executor().run(num_workers, [&](size_t worker) {
+        uint64_t range;
+        while (num_remaining.load(std::memory_order_acquire) > 0) {
+            bool found = deques[worker]->pop(range);
+            for (size_t i = 1; !found && i != num_workers; ++i) {
+                found = deques[(worker + i) % num_workers]->steal(range);
+            }
+            if (!found) {
+                std::this_thread::yield();
+                continue;
+            }
+            size_t begin = static_cast<size_t>(range >> 32);
+            size_t end = static_cast<size_t>(range & 0xffffffffu);
+            while (end - begin > grain) {
+                size_t mid = begin + (end - begin) / 2;
+                deques[worker]->push(static_cast<uint64_t>(mid) << 32 | end);
+                end = mid;
+            }
+            fn(worker, begin, end);
+            num_remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+        }
+    });
+}
+
+
+template <typename D>
+void first_touch(D* ptr_arr, size_t size_arr, size_t num_threads, D val=NAN) {
+    /*
+     * fills freshly allocated (not yet touched) memory with val from num_threads workers, each on its
+     * contiguous share, so that the OS places every page on the NUMA node that roll_ndarray() will use it from,
+     * if it rolls along the contiguous axis.
+     * */
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, size_arr));
+    get_executor().run(num_threads, [=](size_t worker) {
+        std::fill(ptr_arr + size_arr * worker / num_threads, ptr_arr + size_arr * (worker + 1) / num_threads, val);
+    });
+}
+
+
+inline std::vector<size_t> lane_offsets(const std::vector<size_t>& shape, size_t axis, const std::vector<size_t>& strides) {
+    /* offsets of the first cell of every lane along 'axis', the smallest other axis varies fastest. */
+    size_t ndim = shape.size();
+    std::vector<size_t> offsets;
+    std::vector<size_t> indices(ndim, 0);
+    while (true) {
+        size_t offset = 0;
+        for (size_t i = 0; i != ndim; ++i) {
+            offset += indices[i] * strides[i];
+        }
+        offsets.push_back(offset);
+        // increment the lowest axis that is not full, resetting the ones below it.
+        size_t current_axis = 0;
+        for (; current_axis != ndim; ++current_axis) {
+            if (current_axis == axis) { continue; }
+            if (++indices[current_axis] < shape[current_axis]) { break; }
+            indices[current_axis] = 0;
+        }
+        if (current_axis == ndim) { break; }
+    }
+    return offsets;
+}
+
+
+/*
+ * SIMD levels of the block kernels. the widest level the CPU and the OS support is detected once, and can be
+ * lowered with RS_SIMD_LEVEL=baseline|avx2|avx512 in the environment or with set_simd_level(), e.g. to compare
+ * results or to avoid AVX-512 frequency drops on older Xeons. levels above the detected one are refused, so a kernel
+ * never runs into an illegal instruction. results are bitwise identical at every level.
+ * */
+enum SimdLevel{ SIMD_BASELINE = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2 };
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX512: return "avx512";
+        case SIMD_AVX2: return "avx2";
+        default: return "baseline";
+    }
+}
+
+inline SimdLevel parse_simd_level(const std::string& name) {
+    if (name == "baseline") { return SIMD_BASELINE; }
+    if (name == "avx2") { return SIMD_AVX2; }
+    if (name == "avx512") { return SIMD_AVX512; }
+    throw std::invalid_argument("RS::parse_simd_level: expected baseline, avx2 or avx512, got " + name);
+}
+
+inline SimdLevel detected_simd_level() {
+#ifdef RS_HAS_SIMD_DISPATCH
+    /* __builtin_cpu_supports also checks that the OS saves the wide registers (XGETBV). */
+    static const SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) { return SIMD_AVX512; }
+        if (__builtin_cpu_supports("avx2")) { return SIMD_AVX2; }
+        return SIMD_BASELINE;
+    }();
+    return level;
+#else
+    return SIMD_BASELINE;
+#endif
+}
+
+inline std::atomic<int>& simd_level_state() {
+    /* the selected level, initialized from RS_SIMD_LEVEL. unknown or unsupported names fall back to the detected level. */
+    static std::atomic<int> level([]() {
+        SimdLevel detected = detected_simd_level();
+        const char* env = std::getenv("RS_SIMD_LEVEL");
+        if (env == nullptr) { return static_cast<int>(detected); }
+        std::string name(env);
+        if (name != "baseline" && name != "avx2" && name != "avx512") { return static_cast<int>(detected); }
+        return static_cast<int>(std::min(parse_simd_level(name), detected));
+    }());
+    return level;
+}
+
+inline SimdLevel simd_level() {
+    return static_cast<SimdLevel>(simd_level_state().load(std::memory_order_relaxed));
+}
+
+inline void set_simd_level(SimdLevel level) {
+    if (level < SIMD_BASELINE || level > detected_simd_level()) {
+        throw std::invalid_argument(std::string("RS::set_simd_level: unsupported level, the CPU supports up to ") + simd_level_name(detected_simd_level()));
+    }
+    simd_level_state().store(level, std::memory_order_relaxed);
+}
+
+
+/*
+ * block kernels. when the rolled axis is not the contiguous one, e.g. axis 0 of a C-order matrix, neighbouring
+ * lanes are neighbours in memory, and a kernel rolls a block of them in one pass along the axis, vectorized
+ * across the lanes. every lane yields exactly the results of push(), pop() and compute() in the same order, so
+ * they are bitwise identical to rolling lane by lane. as the array is overwritten, the window is kept in a ring of
+ * 'window' rows.
+ * AVX2 and AVX-512 come with FMA, and a fused a * b + c rounds differently, so contraction is turned off here. the
+ * classes themselves only see FMA with -march=native, which the build options pair with -ffp-contract=off.
+ * no-trapping-math lets the selects below be vectorized, it only affects floating point exception flags, and the
+ * dynamic cost model vectorizes loops that need an epilogue, which -O2 skips before GCC 13. counts are kept in D,
+ * which is exact as roll_blocks() bounds the window, so that every statement has the width of D: converting
+ * 64-bit integers to double would need AVX-512DQ.
+ * */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off", "no-trapping-math", "vect-cost-model=dynamic")
+#endif
+#ifdef __clang__
+#define RS_NO_FP_CONTRACT _Pragma("STDC FP_CONTRACT OFF")
+#else
+#define RS_NO_FP_CONTRACT
+#endif
+// the max/min/rank kernels rescan the window at every step. beyond these windows the deque or the tree is faster.
+const size_t MAX_SCAN_WINDOW_EXTREMUM = 32;
+const size_t MAX_SCAN_WINDOW_RANK = 256;
+
+template <typename D>
+struct BlockCounters{
+    /* NaN and non-NaN counts per lane, updated when row i is pushed and row i - window leaves the ring. */
+    std::vector<D> counts_notnan;
+    std::vector<D> counts_nan;
+    D min_count;
+    bool all_nan_ok;
+    BlockCounters(size_t num_lanes, size_t window, size_t min_periods, bool skip_nan):
+        counts_notnan(num_lanes, 0), counts_nan(num_lanes, 0),
+        min_count(static_cast<D>(std::min(min_periods, window + 1))),  // a window never has more
+        all_nan_ok(skip_nan) {}
+    RS_ALWAYS_INLINE inline D update(size_t j, D x, D old, bool full) {
+        /* returns the new non-NaN count of lane j. */
+        const D one = 1, zero = 0;
+        bool push_nan = x != x;
+        bool pop_nan = full & (old != old);
+        bool pop_notnan = full & (old == old);
+        D count = counts_notnan[j] + (push_nan ? zero : one) - (pop_notnan ? one : zero);
+        counts_notnan[j] = count;
+        counts_nan[j] = counts_nan[j] + (push_nan ? one : zero) - (pop_nan ? one : zero);
+        return count;
+    }
+    RS_ALWAYS_INLINE inline bool valid(size_t j, D count) const {
+        /* the conditions of roll_lane() and compute(). */
+        return (count >= min_count) & (count > 0) & (all_nan_ok | (counts_nan[j] == 0));
+    }
+};
+
+template <typename D, int NumMoments>
+RS_ALWAYS_INLINE inline void roll_moments_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    /* RollingMean (NumMoments = 1) and RollingVariance (2). */
+    RS_NO_FP_CONTRACT
+    BlockCounters<D> counters(num_lanes, window, min_periods, skip_nan);
+    std::vector<D> ring(window * num_lanes);
+    std::vector<D> sums(NumMoments * num_lanes, 0);
+    D* sum_x = sums.data();
+    D* sum_xx = sums.data() + (NumMoments - 1) * num_lanes;
+    for (size_t i = 0; i != len_lane; ++i) {
+        D* row = ptr + i * stride;
+        D* slot = ring.data() + (i % window) * num_lanes;
+        const bool full = i >= window;
+        for (size_t j = 0; j < num_lanes; ++j) {
+            D x = row[j];
+            D old = slot[j];
+            bool push_nan = x != x;
+            bool pop_notnan = full & (old == old);
+            // adding -0 and subtracting +0 leave any sum unchanged, even -0, so skipped values need no branch.
+            D s1 = (sum_x[j] + (push_nan ? static_cast<D>(-0.0) : x)) - (pop_notnan ? old : static_cast<D>(0));
+            sum_x[j] = s1;
+            D s2 = 0;
+            if (NumMoments == 2) {
+                D xx = x * x;
+                D old_xx = old * old;
+                s2 = (sum_xx[j] + (push_nan ? static_cast<D>(-0.0) : xx)) - (pop_notnan ? old_xx : static_cast<D>(0));
+                sum_xx[j] = s2;
+            }
+            D n = counters.update(j, x, old, full);
+            slot[j] = x;
+            // compute
+            D mean = s1 / n;
+            D val = NumMoments == 1 ? mean : s2 / n - mean * mean;
+            row[j] = counters.valid(j, n) ? val : static_cast<D>(NAN);
+        }
+    }
+}
+
+template <typename D, int Kind>
+RS_ALWAYS_INLINE inline void roll_scan_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    /*
+     * RollingMax (Kind = 0), RollingMin (1), RollingRank (2) and normalized RollingRank (3) over small windows, by
+     * scanning the ring oldest first. the max/min deque yields the oldest of equal extremes (0 and -0), and so does
+     * the strict comparison. the rank counts the values below the newest one, like the tree.
+     * */
+    RS_NO_FP_CONTRACT
+    BlockCounters<D> counters(num_lanes, window, min_periods, skip_nan);
+    std::vector<D> ring(window * num_lanes);
+    std::vector<D> best(num_lanes);
+    const D init = Kind == 0 ? -std::numeric_limits<D>::infinity() : std::numeric_limits<D>::infinity();
+    const D one = 1, zero = 0;
+    for (size_t i = 0; i != len_lane; ++i) {
+        D* row = ptr + i * stride;
+        D* slot = ring.data() + (i % window) * num_lanes;
+        const bool full = i >= window;
+        for (size_t j = 0; j < num_lanes; ++j) {
+            D x = row[j];
+            counters.update(j, x, slot[j], full);
+            slot[j] = x;
+            best[j] = Kind < 2 ? init : zero;  // the rank counts in best
+        }
+        size_t num_rows = std::min(i + 1, window);
+        size_t pos = (i + 1 - num_rows) % window;
+        for (size_t r = 0; r != num_rows; ++r) {
+            const D* vals = ring.data() + pos * num_lanes;
+            for (size_t j = 0; j < num_lanes; ++j) {
+                D v = vals[j];
+                if (Kind == 0) { best[j] = v > best[j] ? v : best[j]; }
+                else if (Kind == 1) { best[j] = v < best[j] ? v : best[j]; }
+                else { best[j] += v < slot[j] ? one : zero; }  // NaN compares false, as it is not in the tree
+            }
+            pos = pos + 1 == window ? 0 : pos + 1;
+        }
+        for (size_t j = 0; j < num_lanes; ++j) {
+            D count = counters.counts_notnan[j];
+            bool valid = counters.valid(j, count);
+            D val = best[j];
+            if (Kind == 3) { val = val / count; }
+            if (Kind >= 2) { valid = valid & (slot[j] == slot[j]); }  // the rank of a NaN is NaN
+            row[j] = valid ? val : static_cast<D>(NAN);
+        }
+    }
+}
+
+enum BlockKernel{ KERNEL_MEAN, KERNEL_VARIANCE, KERNEL_MAX, KERNEL_MIN, KERNEL_RANK, KERNEL_RANK_NORMALIZED };
+
+template <typename D>
+RS_ALWAYS_INLINE inline void roll_block_kernel(BlockKernel kernel, D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    switch (kernel) {
+        case KERNEL_MEAN: roll_moments_block<D, 1>(ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); break;
+        case KERNEL_VARIANCE: roll_moments_block<D, 2>(ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); break;
+        case KERNEL_MAX: roll_scan_block<D, 0>(ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); break;
+        case KERNEL_MIN: roll_scan_block<D, 1>(ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); break;
+        case KERNEL_RANK: roll_scan_block<D, 2>(ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); break;
+        case KERNEL_RANK_NORMALIZED: roll_scan_block<D, 3>(ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); break;
+    }
+}
+
+// one instance per SIMD level. the kernels above are inlined into each, and vectorized for its instruction set.
+template <typename D>
+void roll_block_kernel_baseline(BlockKernel kernel, D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    roll_block_kernel<D>(kernel, ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan);
+}
+#ifdef RS_HAS_SIMD_DISPATCH
+template <typename D>
+RS_TARGET_AVX2 void roll_block_kernel_avx2(BlockKernel kernel, D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    roll_block_kernel<D>(kernel, ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan);
+}
+template <typename D>
+RS_TARGET_AVX512 void roll_block_kernel_avx512(BlockKernel kernel, D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    roll_block_kernel<D>(kernel, ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan);
+}
+#endif
+#undef RS_NO_FP_CONTRACT
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+template <typename D>
+inline void dispatch_block_kernel(BlockKernel kernel, D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, bool skip_nan) {
+    /* runs the instance of the current simd_level(). */
+    switch (simd_level()) {
+#ifdef RS_HAS_SIMD_DISPATCH
+        case SIMD_AVX512: roll_block_kernel_avx512<D>(kernel, ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); return;
+        case SIMD_AVX2: roll_block_kernel_avx2<D>(kernel, ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan); return;
+#endif
+        default: roll_block_kernel_baseline<D>(kernel, ptr, num_lanes, len_lane, stride, window, min_periods, skip_nan);
+    }
+}
+
+
 template <typename D>
 class RollingStatistics{
     /* The base class. */
@@ -57,8 +1082,173 @@ protected:
     size_t num_vals_nan = 0;  // number of NaNs in the current window.
     size_t num_vals_notnan = 0;  // number of non-NaNs in the current window.
     virtual D compute_aux() = 0;  // compute target statistics.
+    virtual void serialize_aux(SerializationWriter& writer) const = 0;  // write class specific state.
+    virtual void deserialize_aux(SerializationReader& reader) = 0;  // read it back, counters are already restored.
+    virtual void memory_usage_aux(MemoryUsage& usage) const = 0;  // set object_bytes and add class specific containers.
+    virtual void swap_aux(RollingStatistics<D>& other) = 0;  // swap class specific state with other, an object of the same class.
+#ifdef RS_ENABLE_INSTRUMENTATION
+    InstrumentationStats stats;
+    inline void count_push(const D& val) { ++stats.num_pushes; stats.num_nans += std::isnan(val); }
+    inline void count_pop() { ++stats.num_pops; }
+    inline void count_tree_op(bool allocates=false) { ++stats.num_tree_ops; stats.num_allocations += allocates; }
+    inline void count_deque_length(size_t n) { stats.max_deque_length = std::max<uint64_t>(stats.max_deque_length, n); }
+#else
+    inline void count_push(const D&) {}
+    inline void count_pop() {}
+    inline void count_tree_op(bool=false) {}
+    inline void count_deque_length(size_t) {}
+#endif
+
+    void roll_lane(D* ptr_lane, size_t stride, size_t begin, size_t end, size_t window, size_t min_periods, const D* warmup, size_t num_warmup) {
+        /* rolls cells [begin, end) of one lane, after pushing num_warmup values that precede cell begin. */
+#ifdef RS_ENABLE_INSTRUMENTATION
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+        clear();
+        for (size_t i = 0; i != num_warmup; ++i) {
+            push(warmup[i]);
+        }
+        D* ptr_cell = ptr_lane + begin * stride;
+        for (size_t i = begin; i != end; ++i) {
+            push(*ptr_cell);
+            if (size() > window) {
+                pop();
+            }
+            if (size_notnan() >= min_periods) {
+                *ptr_cell = compute();
+            }
+            else {
+                *ptr_cell = NAN;
+            }
+            ptr_cell += stride;
+        }
+#ifdef RS_ENABLE_INSTRUMENTATION
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        ++stats.num_lanes;
+        stats.lane_nanoseconds += ns;
+        stats.max_lane_nanoseconds = std::max(stats.max_lane_nanoseconds, ns);
+#endif
+    }
+
+    virtual bool roll_block(D*, size_t, size_t, size_t, size_t, size_t) const { return false; }  // a block kernel, if the class has one
+
+    bool roll_blocks(D* ptr_arr, const std::vector<size_t>& shape, size_t axis, const std::vector<size_t>& strides, std::vector<size_t>& lanes, size_t window, size_t min_periods, size_t num_threads) {
+        /*
+         * rolls lanes that are neighbours in memory in blocks with roll_block(). returns false without touching the
+         * array if the class has no block kernel, or if no axis other than 'axis' is contiguous. blocks are cut so
+         * that their ring of window rows stays within L2.
+         * */
+        size_t inner = shape.size();
+        for (size_t i = 0; i != shape.size(); ++i) {
+            if (i != axis && strides[i] == 1 && shape[i] > 1) { inner = i; }
+        }
+        if (inner == shape.size() || window == 0 || window >= (size_t(1) << std::numeric_limits<D>::digits)) { return false; }  // counts are exact in D
+        if (!roll_block(nullptr, 0, 0, 0, window, min_periods)) { return false; }
+        size_t max_lanes = std::min<size_t>(256, std::max<size_t>(16, (256 << 10) / (window * sizeof(D))));
+        std::sort(lanes.begin(), lanes.end());
+        std::vector<std::pair<size_t, size_t>> blocks;  // first lane and number of lanes
+        for (size_t lane = 0; lane != lanes.size();) {
+            size_t num_lanes = 1;
+            while (lane + num_lanes != lanes.size() && num_lanes != max_lanes && lanes[lane + num_lanes] == lanes[lane] + num_lanes) { ++num_lanes; }
+            blocks.push_back(std::make_pair(lanes[lane], num_lanes));
+            lane += num_lanes;
+        }
+        size_t len_lane = shape[axis];
+        size_t stride = strides[axis];
+        auto roll = [&](size_t, size_t block_begin, size_t block_end) {
+            for (size_t block = block_begin; block != block_end; ++block) {
+                roll_block(ptr_arr + blocks[block].first, blocks[block].second, len_lane, stride, window, min_periods);
+            }
+        };
+        if (num_threads == 1) { roll(0, 0, blocks.size()); }
+        else { parallel_for(blocks.size(), num_threads, 1, roll); }
+        return true;
+    }
+
+    static size_t num_chunks_per_lane(size_t num_lanes, size_t len_lane, size_t window, size_t num_threads, bool deterministic) {
+        /*
+         * deterministic: chunks of at least DETERMINISTIC_CHUNK_LENGTH and 16 windows, whatever the number of threads,
+         * so that results are bitwise identical on any machine. otherwise lanes are only cut if there are fewer
+         * of them than threads, into chunks of at least 'window' cells, so warming up never costs more than the chunk.
+         * */
+        size_t min_len_chunk = std::max<size_t>(1, window);
+        if (deterministic) {
+            return std::max<size_t>(1, len_lane / std::max(DETERMINISTIC_CHUNK_LENGTH, 16 * min_len_chunk));
+        }
+        if (num_lanes >= num_threads) { return 1; }
+        return std::min((num_threads + num_lanes - 1) / num_lanes, std::max<size_t>(1, len_lane / min_len_chunk));
+    }
+
+    void roll_ndarray_parallel(D* ptr_arr, const std::vector<size_t>& lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods, size_t num_threads, size_t num_chunks) {
+        /*
+         * runs lanes * num_chunks tasks on num_threads workers with work stealing.
+         * warm-up values are copied out before any thread starts, as the preceding chunk overwrites them in place.
+         * */
+        size_t num_lanes = lanes.size();
+        size_t len_chunk = (len_lane + num_chunks - 1) / num_chunks;
+        size_t len_warmup = window > 0 ? window - 1 : 0;
+        size_t num_tasks = num_lanes * num_chunks;
+
+        std::vector<D> warmups(num_chunks > 1 ? num_tasks * len_warmup : 0);
+        if (num_chunks > 1) {
+            for (size_t task = 0; task != num_tasks; ++task) {
+                size_t begin = (task % num_chunks) * len_chunk;
+                size_t num_warmup = std::min(begin, len_warmup);
+                const D* ptr_lane = ptr_arr + lanes[task / num_chunks];
+                for (size_t i = 0; i != num_warmup; ++i) {
+                    warmups[task * len_warmup + i] = ptr_lane[(begin - num_warmup + i) * stride];
+                }
+            }
+        }
+
+        // a few ranges per worker up front, stealing and halving take care of uneven lanes.
+        size_t grain = std::max<size_t>(1, num_tasks / (16 * num_threads));
+        std::vector<std::unique_ptr<RollingStatistics<D>>> workers_rs(std::min(num_threads, num_tasks));
+        parallel_for(num_tasks, num_threads, grain, [&](size_t worker, size_t task_begin, size_t task_end) {
+            if (!workers_rs[worker]) {
+                workers_rs[worker] = clone();
+                workers_rs[worker]->reset_instrumentation();  // counted once, when merged back below
+            }
+            for (size_t task = task_begin; task != task_end; ++task) {
+                size_t begin = std::min(len_lane, (task % num_chunks) * len_chunk);
+                size_t end = std::min(len_lane, begin + len_chunk);
+                size_t num_warmup = num_chunks > 1 ? std::min(begin, len_warmup) : 0;
+                workers_rs[worker]->roll_lane(ptr_arr + lanes[task / num_chunks], stride, begin, end, window, min_periods,
+                                              warmups.data() + task * len_warmup, num_warmup);
+            }
+        });
+#ifdef RS_ENABLE_INSTRUMENTATION
+        for (size_t worker = 0; worker != workers_rs.size(); ++worker) {
+            if (!workers_rs[worker]) { continue; }
+            stats.merge(workers_rs[worker]->stats);
+            ++stats.num_allocations;
+        }
+#endif
+    }
 public:
     static const std::string name;  // prefix for name of class in Python
+    virtual const std::string& class_name() const = 0;  // name of the most derived class
+    virtual ~RollingStatistics() {}
+    virtual std::unique_ptr<RollingStatistics<D>> clone() const = 0;  // a copy with the same parameters and window
+    InstrumentationStats instrumentation() const {
+        /* counters since construction or the last reset, all zero unless compiled with RS_ENABLE_INSTRUMENTATION. */
+#ifdef RS_ENABLE_INSTRUMENTATION
+        return stats;
+#else
+        return InstrumentationStats();
+#endif
+    }
+    void reset_instrumentation() {
+#ifdef RS_ENABLE_INSTRUMENTATION
+        stats = InstrumentationStats();
+#endif
+    }
+    MemoryUsage memory_usage() const {
+        /* bytes held by this object and its window, see MemoryUsage. */
+        MemoryUsage usage;
+        memory_usage_aux(usage);
+        return usage;
+    }
     virtual void clear() = 0;
     // accessor functions
     inline size_t size() const { return num_vals_nan + num_vals_notnan; }
@@ -75,10 +1265,65 @@ public:
         }
     }
 
-    void roll_ndarray(D* ptr_arr, const std::vector<size_t>& shape, size_t axis, size_t window, size_t min_periods, std::vector<size_t> strides={}) {
-        /* inplace rolling, accepts one pointer. */
+    std::string serialize() const {
+        /* checkpoint the whole state (window, moments, counters etc.) into a compact binary string. */
+        SerializationWriter writer;
+        writer.write<uint32_t>(SERIALIZATION_MAGIC);
+        writer.write<uint16_t>(SERIALIZATION_VERSION);
+        writer.write<uint8_t>(static_cast<uint8_t>(sizeof(D)));
+        writer.write_string(class_name());
+        writer.write<uint8_t>(skip_nan);
+        writer.write<uint64_t>(num_vals_nan);
+        writer.write<uint64_t>(num_vals_notnan);
+        serialize_aux(writer);
+        return writer.buf;
+    }
+
+    void deserialize(const std::string& data) {
+        /*
+         * restore a state written by serialize() of the same class and value_type. it is decoded into a copy that is
+         * swapped in once complete, so this object is left as it was if anything throws.
+         * */
+        SerializationReader reader(data.data(), data.size());
+        if (reader.read<uint32_t>() != SERIALIZATION_MAGIC) {
+            throw std::runtime_error("RS::deserialize: not a RollingStatistics checkpoint");
+        }
+        if (reader.read<uint16_t>() != SERIALIZATION_VERSION) {
+            throw std::runtime_error("RS::deserialize: unsupported checkpoint version");
+        }
+        if (reader.read<uint8_t>() != sizeof(D)) {
+            throw std::runtime_error("RS::deserialize: checkpoint was written with a different value_type");
+        }
+        if (reader.read_string() != class_name()) {
+            throw std::runtime_error("RS::deserialize: checkpoint was written by a different class");
+        }
+        std::unique_ptr<RollingStatistics<D>> restored = clone();
+        restored->clear();
+        restored->skip_nan = reader.read<uint8_t>() != 0;
+        restored->num_vals_nan = static_cast<size_t>(reader.read<uint64_t>());
+        restored->num_vals_notnan = static_cast<size_t>(reader.read<uint64_t>());
+        restored->deserialize_aux(reader);
+        if (!reader.at_end()) {
+            throw std::runtime_error("RS::deserialize: trailing data after checkpoint");
+        }
+        std::swap(skip_nan, restored->skip_nan);
+        std::swap(num_vals_nan, restored->num_vals_nan);
+        std::swap(num_vals_notnan, restored->num_vals_notnan);
+        swap_aux(*restored);
+    }
+
+    void roll_ndarray(D* ptr_arr, const std::vector<size_t>& shape, size_t axis, size_t window, size_t min_periods, std::vector<size_t> strides={}, size_t num_threads=1, bool deterministic=false) {
+        /*
+         * inplace rolling, accepts one pointer.
+         * num_threads > 1 (or 0 for all hardware threads) runs on copies of this object in parallel: whole lanes when
+         * there are enough of them, otherwise each lane is also cut into chunks, and every chunk is first warmed up on
+         * the window - 1 values preceding it. deterministic fixes the chunks regardless of num_threads.
+         * whichever path is taken, the window of this object is cleared on entry and is empty on return.
+         * */
+        clear();
         size_t ndim = shape.size();
         assert(ndim > 0);
+        assert(axis < ndim);
         assert(strides.empty() || strides.size() == ndim);
 
         // calculate the size of the array
@@ -86,6 +1331,7 @@ public:
         for (size_t i = 0; i != ndim; ++i){
             size_arr *= shape[i];
         }
+        if (size_arr == 0) { return; }
         // initialise strides to c-style
         if (strides.empty()){
             size_t stride = 1;
@@ -97,72 +1343,71 @@ public:
         }
         // above code is different for cpp and python
 
-        std::vector<size_t> indices(ndim);  // stores indices for each axis
-        size_t scalar_index;  // index for flattened array
-        // perform ndim layers of loop (innermost layer is axis 'axis')
-        size_t current_axis;
-        if (ndim == 1) {
-            current_axis = 0;
+        std::vector<size_t> lanes = lane_offsets(shape, axis, strides);
+        if (num_threads == 0) {
+            num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
         }
-        else {
-            current_axis = (axis == 0 ? 1 : 0);  // start from the smallest axis that is not 'axis'
-        }
-        while (true) {
-            clear();
-            scalar_index = 0;
-            indices[axis] = 0;
-            for (size_t i = 0; i != ndim; ++i) {
-                scalar_index += indices[i] * strides[i];
-            }
-            assert(scalar_index < size_arr);  // prevent out of bounds
-            for (indices[axis] = 0; indices[axis] != shape[axis]; ++indices[axis]) {
-                push(*(ptr_arr + scalar_index));
-                if (indices[axis] >= window) {
-                    pop();
-                }
-                if (size_notnan() >= min_periods) {
-                    *(ptr_arr + scalar_index) = compute();
-                }
-                else {
-                    *(ptr_arr + scalar_index) = NAN;
-                }
-                scalar_index += strides[axis];
-            }
-            assert(indices[axis] > 0);
-            --indices[axis];
-            // go to the next layer until it's not full, then increment it and go back to the first layer.
-            if (indices[current_axis] == shape[current_axis] - 1) {
-                while (indices[current_axis] == shape[current_axis] - 1) {
-                    indices[current_axis] = 0;
-                    ++current_axis;
-                    if (current_axis == axis) {
-                        ++current_axis;
-                    }
-                }
-                if (current_axis < ndim) {
-                    ++indices[current_axis];
-                }
-                else {
-                    break;
-                }
-                current_axis = (axis == 0 ? 1 : 0);
-            }
-            else {
-                ++indices[current_axis];
+        size_t num_chunks = num_chunks_per_lane(lanes.size(), shape[axis], window, num_threads, deterministic);
+        if (num_chunks == 1 && roll_blocks(ptr_arr, shape, axis, strides, lanes, window, min_periods, num_threads)) { return; }
+        if (num_threads == 1 && num_chunks == 1) {
+            for (size_t lane = 0; lane != lanes.size(); ++lane) {
+                assert(lanes[lane] < size_arr);  // prevent out of bounds
+                roll_lane(ptr_arr + lanes[lane], strides[axis], 0, shape[axis], window, min_periods, nullptr, 0);
             }
+            clear();  // do not keep the window of the last lane
+        }
+        else {
+            // in memory order. along the contiguous axis, each worker then rolls one contiguous region, which
+            // first_touch() placed on its node.
+            std::sort(lanes.begin(), lanes.end());
+            roll_ndarray_parallel(ptr_arr, lanes, shape[axis], strides[axis], window, min_periods, num_threads, num_chunks);
         }
     }
+
 };
 
 
-template <typename D>
+template <typename D, class Window = std::queue<D>>
 class RollingMomentStatistics: public RollingStatistics<D> {
     /* An abstract class for rolling moment statistics, e.g. rolling mean. */
 protected:
     std::vector<D> unnormalized_moments;  // one or more variables to maintain, e.g. rolling sum of x_i or x_i^2.
-    std::vector<std::queue<D>> vecs_in_window;  // unnormalized_moments.size() number of queues of x_i^j, one queue for each j.
+    std::vector<Window> vecs_in_window;  // unnormalized_moments.size() number of queues of x_i^j, one queue for each j.
     size_t num_moments = 0;
     inline const std::vector<D>& get_moments() const { return this->unnormalized_moments; }
+    void serialize_aux(SerializationWriter& writer) const {
+        writer.write_array(this->unnormalized_moments.data(), this->num_moments);
+        for (size_t index = 0; index != this->num_moments; ++index) {
+            write_window(writer, this->vecs_in_window[index]);
+        }
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        /* the sums are restored as they were, not recomputed, so results continue bit for bit. */
+        std::vector<D> moments_ = reader.read_array<D>();
+        if (moments_.size() != this->num_moments) {
+            throw std::runtime_error("RS::deserialize: wrong number of moments");
+        }
+        this->unnormalized_moments = moments_;
+        for (size_t index = 0; index != this->num_moments; ++index) {
+            read_window(reader, this->vecs_in_window[index]);
+        }
+        if (this->vecs_in_window[0].size() != this->size()) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingMomentStatistics<D, Window>& o = static_cast<RollingMomentStatistics<D, Window>&>(other);
+        this->unnormalized_moments.swap(o.unnormalized_moments);
+        this->vecs_in_window.swap(o.vecs_in_window);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, this->unnormalized_moments);
+        add_memory_usage(usage, this->vecs_in_window);
+        for (size_t index = 0; index != this->num_moments; ++index) {
+            add_memory_usage(usage, this->vecs_in_window[index]);
+        }
+    }
 public:
     RollingMomentStatistics(bool skip_nan_, int num_moments_){
         this->skip_nan = skip_nan_;
@@ -172,7 +1417,7 @@ public:
     void clear() {
         /* can be manually called or called by the constructor */
         this->unnormalized_moments = std::vector<D>(this->num_moments, 0);
-        this->vecs_in_window = std::vector<std::queue<D>>(this->num_moments);
+        this->vecs_in_window = std::vector<Window>(this->num_moments);
         this->num_vals_nan = 0;
         this->num_vals_notnan = 0;
     }
@@ -189,6 +1434,7 @@ public:
     }
     void push_aux(D val, size_t index) {
         /* add a new val to the maintained window */
+        if (index == 0) { this->count_push(val); }
         this->vecs_in_window[index].push(val);
         if (!std::isnan(val)) {
             this->unnormalized_moments[index] += val;
@@ -205,6 +1451,7 @@ public:
     void pop_aux(size_t index) {
         /* remove a val from the maintained window, which should have been pushed before. */
         assert(!this->vecs_in_window[index].empty());
+        if (index == 0) { this->count_pop(); }
         const D& val = this->vecs_in_window[index].front();
         if (!std::isnan(val)) {
             this->unnormalized_moments[index] -= val;
@@ -215,30 +1462,82 @@ public:
         }
         this->vecs_in_window[index].pop();
     }
+protected:
+    void check_mergeable(const RollingMomentStatistics<D, Window>& other) const {
+        if (other.class_name() != this->class_name() || other.num_moments != this->num_moments) {
+            throw std::invalid_argument("RS::merge: cannot combine " + other.class_name() + " into " + this->class_name());
+        }
+    }
+    void merge_aux(const RollingMomentStatistics<D, Window>& other, size_t index) {
+        /* append the values of other to the window, and add its sum. */
+        append_window(this->vecs_in_window[index], other.vecs_in_window[index]);
+        this->unnormalized_moments[index] += other.unnormalized_moments[index];
+    }
+    void subtract_aux(const RollingMomentStatistics<D, Window>& other, size_t index) {
+        /* drop the oldest values, which should be the values of other, and subtract its sum. */
+        drop_window_front(this->vecs_in_window[index], other.vecs_in_window[index].size());
+        this->unnormalized_moments[index] -= other.unnormalized_moments[index];
+    }
+    void replace_aux(const RollingMomentStatistics<D, Window>& other, size_t index) {
+        /* take over a short window of other, unless it is empty. */
+        if (!other.vecs_in_window[index].empty()) {
+            this->vecs_in_window[index] = other.vecs_in_window[index];
+            this->unnormalized_moments[index] = other.unnormalized_moments[index];
+        }
+    }
+public:
+    virtual void merge(const RollingMomentStatistics<D, Window>& other) {
+        /*
+         * combine with the window of another object of the same class, as if its values were pushed after ours.
+         * moments are added instead of recomputed, so partial windows can be built in parallel and combined.
+         * */
+        check_mergeable(other);
+        for (size_t index = 0; index != this->num_moments; ++index) {
+            merge_aux(other, index);
+        }
+        this->num_vals_nan += other.num_vals_nan;
+        this->num_vals_notnan += other.num_vals_notnan;
+    }
+    virtual void subtract(const RollingMomentStatistics<D, Window>& other) {
+        /* the inverse of merge(): remove the oldest other.size() values, which must be the window of other. */
+        check_mergeable(other);
+        assert(other.size() <= this->size());
+        for (size_t index = 0; index != this->num_moments; ++index) {
+            subtract_aux(other, index);
+        }
+        this->num_vals_nan -= other.num_vals_nan;
+        this->num_vals_notnan -= other.num_vals_notnan;
+    }
 };
 
 
-template <typename D>
-class RollingMean : public RollingMomentStatistics<D> {
+template <typename D, class Window = std::queue<D>>
+class RollingMean : public RollingMomentStatistics<D, Window> {
     /* unnormalized_moments[0] stores \Sum{x_i} */
 protected:
     D compute_aux() {
         D n = static_cast<D>(this->num_vals_notnan);
         return this->get_moments()[0] / n;
     }
+    bool roll_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods) const {
+        if (num_lanes > 0) { dispatch_block_kernel(KERNEL_MEAN, ptr, num_lanes, len_lane, stride, window, min_periods, this->skip_nan); }
+        return true;
+    }
 public:
-    explicit RollingMean(bool skip_nan_=true): RollingMomentStatistics<D>(skip_nan_, 1){}
+    explicit RollingMean(bool skip_nan_=true): RollingMomentStatistics<D, Window>(skip_nan_, 1){}
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingMean<D, Window>(*this)); }
     void push(const D& val) {
         this->push_aux(val, 0);
     }
 };
-template <typename D>
-const std::string RollingMean<D>::name = "RollingMean";
+template <typename D, class Window>
+const std::string RollingMean<D, Window>::name = "RollingMean";
 
 
-template <typename D>
-class RollingVariance : public RollingMomentStatistics<D> {
+template <typename D, class Window = std::queue<D>>
+class RollingVariance : public RollingMomentStatistics<D, Window> {
     /* unnormalized_moments[0] stores \Sum{x_i}, unnormalized_moments[1] stores \Sum{x_i^2} */
 protected:
     D compute_aux() {
@@ -248,20 +1547,26 @@ protected:
         D x_mean = moments_[0] / n;
         return moments_[1] / n - x_mean * x_mean;
     }
+    bool roll_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods) const {
+        if (num_lanes > 0) { dispatch_block_kernel(KERNEL_VARIANCE, ptr, num_lanes, len_lane, stride, window, min_periods, this->skip_nan); }
+        return true;
+    }
 public:
-    explicit RollingVariance(bool skip_nan_=true): RollingMomentStatistics<D>(skip_nan_, 2){}
+    explicit RollingVariance(bool skip_nan_=true): RollingMomentStatistics<D, Window>(skip_nan_, 2){}
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingVariance<D, Window>(*this)); }
     void push(const D& val) {
         this->push_aux(val, 0);
         this->push_aux(val * val, 1);
     }
 };
-template <typename D>
-const std::string RollingVariance<D>::name = "RollingVariance";
+template <typename D, class Window>
+const std::string RollingVariance<D, Window>::name = "RollingVariance";
 
 
-template <typename D>
-class RollingSkewness : public RollingMomentStatistics<D> {
+template <typename D, class Window = std::queue<D>>
+class RollingSkewness : public RollingMomentStatistics<D, Window> {
     /* unnormalized_moments: \Sum{x_i}, \Sum{x_i^2}, \Sum{x_i^3} */
 protected:
     D compute_aux() {
@@ -283,20 +1588,22 @@ protected:
         }
     }
 public:
-    explicit RollingSkewness(bool skip_nan_=true): RollingMomentStatistics<D>(skip_nan_, 3){}
+    explicit RollingSkewness(bool skip_nan_=true): RollingMomentStatistics<D, Window>(skip_nan_, 3){}
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingSkewness<D, Window>(*this)); }
     void push(const D& val) {
         this->push_aux(val, 0);
         this->push_aux(val * val, 1);
         this->push_aux(val * val * val, 2);
     }
 };
-template <typename D>
-const std::string RollingSkewness<D>::name = "RollingSkewness";
+template <typename D, class Window>
+const std::string RollingSkewness<D, Window>::name = "RollingSkewness";
 
 
-template <typename D>
-class RollingZScore : public RollingMomentStatistics<D> {
+template <typename D, class Window = std::queue<D>>
+class RollingZScore : public RollingMomentStatistics<D, Window> {
     /* unnormalized_moments[0]~[2] store \Sum{x_i}, x_i, \Sum{x_i^2} */
 protected:
     D compute_aux() {
@@ -312,8 +1619,10 @@ protected:
         }
     }
 public:
-    explicit RollingZScore(bool skip_nan_=true): RollingMomentStatistics<D>(skip_nan_, 3){}
+    explicit RollingZScore(bool skip_nan_=true): RollingMomentStatistics<D, Window>(skip_nan_, 3){}
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingZScore<D, Window>(*this)); }
     void push(const D& val) {
         this->push_aux(val, 0);
         if (this->vecs_in_window[1].size() >= 1) {  // maintain a short window of 1
@@ -326,27 +1635,455 @@ public:
         this->pop_aux(0);
         this->pop_aux(2);
     }
+    void merge(const RollingMomentStatistics<D, Window>& other) {
+        /* x_i of the window of 1 is replaced by the latest one of other, if any. */
+        this->check_mergeable(other);
+        this->merge_aux(other, 0);
+        this->merge_aux(other, 2);
+        this->replace_aux(other, 1);
+        this->num_vals_nan += other.size_nan();
+        this->num_vals_notnan += other.size_notnan();
+    }
+    void subtract(const RollingMomentStatistics<D, Window>& other) {
+        this->check_mergeable(other);
+        assert(other.size() <= this->size());
+        this->subtract_aux(other, 0);
+        this->subtract_aux(other, 2);
+        this->num_vals_nan -= other.size_nan();
+        this->num_vals_notnan -= other.size_notnan();
+    }
 };
-template <typename D>
-const std::string RollingZScore<D>::name = "RollingZScore";
+template <typename D, class Window>
+const std::string RollingZScore<D, Window>::name = "RollingZScore";
 
 
-template <typename D>
+template <typename D, class Window = std::queue<D>>
 class RollingMax : public RollingStatistics<D>{
     /* uses a std::deque, see same question in leetcode for explanation. */
 protected:
-    std::queue<D> vals_in_window;
+    Window vals_in_window;
     std::deque<D> maximums;
     D compute_aux(){
         return maximums.front();
     }
-public:
-    explicit RollingMax(bool skip_nan_=true){ this->skip_nan = skip_nan_; clear(); }
+    void serialize_aux(SerializationWriter& writer) const {
+        write_window(writer, vals_in_window);
+        writer.write_container<D>(maximums);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        read_window(reader, vals_in_window);
+        std::vector<D> vals = reader.read_array<D>();
+        maximums = std::deque<D>(vals.begin(), vals.end());
+        if (vals_in_window.size() != this->size()) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingMax<D, Window>& o = static_cast<RollingMax<D, Window>&>(other);
+        std::swap(vals_in_window, o.vals_in_window);
+        maximums.swap(o.maximums);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+        add_memory_usage(usage, maximums);
+    }
+    bool roll_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods) const {
+        if (window > MAX_SCAN_WINDOW_EXTREMUM) { return false; }
+        if (num_lanes > 0) { dispatch_block_kernel(KERNEL_MAX, ptr, num_lanes, len_lane, stride, window, min_periods, this->skip_nan); }
+        return true;
+    }
+public:
+    explicit RollingMax(bool skip_nan_=true){ this->skip_nan = skip_nan_; clear(); }
+    static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingMax<D, Window>(*this)); }
+    void clear() {
+        /* can be manually called or called by the constructor */
+        vals_in_window = Window();
+        maximums = std::deque<D>();
+        this->num_vals_nan = 0;
+        this->num_vals_notnan = 0;
+    }
+    D front(){
+        assert(!vals_in_window.empty());
+        return vals_in_window.front();
+    }
+    void push(const D& val){
+        this->count_push(val);
+        vals_in_window.push(val);
+        if (std::isnan(val)){
+            ++this->num_vals_nan;
+        } else {
+            while (!maximums.empty() && maximums.back() < val){ maximums.pop_back(); }
+            maximums.push_back(val);
+            this->count_deque_length(maximums.size());
+            ++this->num_vals_notnan;
+        }
+    }
+    void pop(){
+        this->count_pop();
+        D val = front();
+        vals_in_window.pop();
+        if (std::isnan(val)){
+            --this->num_vals_nan;
+        } else {
+            if (val == maximums.front()){ maximums.pop_front(); }
+            --this->num_vals_notnan;
+        }
+    }
+    void merge(const RollingMax<D, Window>& other){
+        /*
+         * combine with the window of other, as if its values were pushed after ours. our deque keeps only the
+         * values that would survive all of other's values, followed by other's deque.
+         * */
+        append_window(vals_in_window, other.vals_in_window);
+        if (!other.maximums.empty()){
+            while (!maximums.empty() && maximums.back() < other.maximums.front()){ maximums.pop_back(); }
+            maximums.insert(maximums.end(), other.maximums.begin(), other.maximums.end());
+        }
+        this->num_vals_nan += other.num_vals_nan;
+        this->num_vals_notnan += other.num_vals_notnan;
+    }
+    void subtract(const RollingMax<D, Window>& other){
+        /* remove the oldest other.size() values, which must be the window of other. the deque needs them popped one by one. */
+        assert(other.size() <= this->size());
+        for (size_t i = 0; i != other.size(); ++i){ pop(); }
+    }
+};
+template <typename D, class Window>
+const std::string RollingMax<D, Window>::name = "RollingMax";
+
+
+template <typename D, class Window = std::queue<D>>
+class RollingMin : public RollingStatistics<D>{
+protected:
+    Window vals_in_window;
+    std::deque<D> minimums;
+    D compute_aux(){
+        return minimums.front();
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        write_window(writer, vals_in_window);
+        writer.write_container<D>(minimums);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        read_window(reader, vals_in_window);
+        std::vector<D> vals = reader.read_array<D>();
+        minimums = std::deque<D>(vals.begin(), vals.end());
+        if (vals_in_window.size() != this->size()) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingMin<D, Window>& o = static_cast<RollingMin<D, Window>&>(other);
+        std::swap(vals_in_window, o.vals_in_window);
+        minimums.swap(o.minimums);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+        add_memory_usage(usage, minimums);
+    }
+    bool roll_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods) const {
+        if (window > MAX_SCAN_WINDOW_EXTREMUM) { return false; }
+        if (num_lanes > 0) { dispatch_block_kernel(KERNEL_MIN, ptr, num_lanes, len_lane, stride, window, min_periods, this->skip_nan); }
+        return true;
+    }
+public:
+    explicit RollingMin(bool skip_nan_=true){ this->skip_nan = skip_nan_; clear(); }
+    static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingMin<D, Window>(*this)); }
+    void clear() {
+        /* can be manually called or called by the constructor */
+        vals_in_window = Window();
+        minimums = std::deque<D>();
+        this->num_vals_nan = 0;
+        this->num_vals_notnan = 0;
+    }
+    D front(){
+        assert(!vals_in_window.empty());
+        return vals_in_window.front();
+    }
+    void push(const D& val){
+        this->count_push(val);
+        vals_in_window.push(val);
+        if (std::isnan(val)){
+            ++this->num_vals_nan;
+        } else {
+            while (!minimums.empty() && minimums.back() > val){ minimums.pop_back(); }
+            minimums.push_back(val);
+            this->count_deque_length(minimums.size());
+            ++this->num_vals_notnan;
+        }
+    }
+    void pop(){
+        this->count_pop();
+        D val = front();
+        vals_in_window.pop();
+        if (std::isnan(val)){
+            --this->num_vals_nan;
+        } else {
+            if (val == minimums.front()){ minimums.pop_front(); }
+            --this->num_vals_notnan;
+        }
+    }
+    void merge(const RollingMin<D, Window>& other){
+        /*
+         * combine with the window of other, as if its values were pushed after ours. our deque keeps only the
+         * values that would survive all of other's values, followed by other's deque.
+         * */
+        append_window(vals_in_window, other.vals_in_window);
+        if (!other.minimums.empty()){
+            while (!minimums.empty() && minimums.back() > other.minimums.front()){ minimums.pop_back(); }
+            minimums.insert(minimums.end(), other.minimums.begin(), other.minimums.end());
+        }
+        this->num_vals_nan += other.num_vals_nan;
+        this->num_vals_notnan += other.num_vals_notnan;
+    }
+    void subtract(const RollingMin<D, Window>& other){
+        /* remove the oldest other.size() values, which must be the window of other. the deque needs them popped one by one. */
+        assert(other.size() <= this->size());
+        for (size_t i = 0; i != other.size(); ++i){ pop(); }
+    }
+};
+template <typename D, class Window>
+const std::string RollingMin<D, Window>::name = "RollingMin";
+
+
+template <typename D>
+class RollingRank : public RollingStatistics<D>{
+protected:
+    std::deque<D> vals_in_window;
+    order_statistics_tree<D> ost;
+    bool normalize = false;
+    D compute_aux(){
+        /* the rank of a NaN is undefined, and the tree would return an arbitrary count for it. */
+        if (std::isnan(vals_in_window.back())) { return NAN; }
+        this->count_tree_op();
+        D val = ost.order_of_key(vals_in_window.back());
+        if (normalize){ val /= this->num_vals_notnan; }
+        return val;
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        writer.write<uint8_t>(normalize);
+        writer.write_container<D>(vals_in_window);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        /* the tree holds exactly the non-NaN values of the window, so it is rebuilt from them. */
+        normalize = reader.read<uint8_t>() != 0;
+        std::vector<D> vals = reader.read_array<D>();
+        vals_in_window = std::deque<D>(vals.begin(), vals.end());
+        for (size_t i = 0; i != vals.size(); ++i) {
+            if (!std::isnan(vals[i])) { ost.insert(vals[i]); }
+        }
+        if (vals_in_window.size() != this->size() || ost.size() != this->num_vals_notnan) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingRank<D>& o = static_cast<RollingRank<D>&>(other);
+        vals_in_window.swap(o.vals_in_window);
+        ost.swap(o.ost);
+        std::swap(normalize, o.normalize);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+        add_memory_usage(usage, ost);
+    }
+    bool roll_block(D* ptr, size_t num_lanes, size_t len_lane, size_t stride, size_t window, size_t min_periods) const {
+        if (window > MAX_SCAN_WINDOW_RANK) { return false; }
+        if (num_lanes > 0) { dispatch_block_kernel(normalize ? KERNEL_RANK_NORMALIZED : KERNEL_RANK, ptr, num_lanes, len_lane, stride, window, min_periods, this->skip_nan); }
+        return true;
+    }
+public:
+    explicit RollingRank(bool skip_nan_=true, bool normalize_=false){ this->skip_nan = skip_nan_; normalize = normalize_; clear(); }
+    static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingRank<D>(*this)); }
+    void clear() {
+        /* can be manually called or called by the constructor */
+        vals_in_window = std::deque<D>();
+        ost = order_statistics_tree<D>();
+        this->num_vals_nan = 0;
+        this->num_vals_notnan = 0;
+    }
+    D front(){
+        assert(!vals_in_window.empty());
+        return vals_in_window.front();
+    }
+    void push(const D& val){
+        this->count_push(val);
+        vals_in_window.push_back(val);
+        if (std::isnan(val)){
+            ++this->num_vals_nan;
+        } else {
+            ost.insert(val);
+            this->count_tree_op(true);
+            ++this->num_vals_notnan;
+        }
+    }
+    void pop(){
+        this->count_pop();
+        D val = front();
+        vals_in_window.pop_front();
+        if (std::isnan(val)){
+            --this->num_vals_nan;
+        } else {
+            ost.erase(ost.upper_bound(val));
+            this->count_tree_op();
+            --this->num_vals_notnan;
+        }
+    }
+};
+template <typename D>
+const std::string RollingRank<D>::name = "RollingRank";
+
+
+template <typename D>
+class RollingOrderStatistics : public RollingStatistics<D>{
+protected:
+    std::deque<D> vals_in_window;
+    order_statistics_tree<D> ost;
+    bool normalize = false;
+    D compute_aux(){
+        size_t real_order = std::min(this->num_vals_notnan - 1, static_cast<size_t>(normalize ? order * this->num_vals_notnan: order));
+        this->count_tree_op();
+        return *(ost.find_by_order(real_order));
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        writer.write<uint8_t>(normalize);
+        writer.write<D>(order);
+        writer.write_container<D>(vals_in_window);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        /* the tree holds exactly the non-NaN values of the window, so it is rebuilt from them. */
+        normalize = reader.read<uint8_t>() != 0;
+        order = reader.read<D>();
+        std::vector<D> vals = reader.read_array<D>();
+        vals_in_window = std::deque<D>(vals.begin(), vals.end());
+        for (size_t i = 0; i != vals.size(); ++i) {
+            if (!std::isnan(vals[i])) { ost.insert(vals[i]); }
+        }
+        if (vals_in_window.size() != this->size() || ost.size() != this->num_vals_notnan) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingOrderStatistics<D>& o = static_cast<RollingOrderStatistics<D>&>(other);
+        vals_in_window.swap(o.vals_in_window);
+        ost.swap(o.ost);
+        std::swap(normalize, o.normalize);
+        std::swap(order, o.order);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+        add_memory_usage(usage, ost);
+    }
+public:
+    D order = 0.0;
+    explicit RollingOrderStatistics(D order_, bool skip_nan_=true, bool normalize_=false){
+        order = order_;
+        this->skip_nan = skip_nan_;
+        normalize = normalize_;
+        clear();
+    }
+    static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingOrderStatistics<D>(*this)); }
+    void clear() {
+        /* can be manually called or called by the constructor */
+        vals_in_window = std::deque<D>();
+        ost = order_statistics_tree<D>();
+        this->num_vals_nan = 0;
+        this->num_vals_notnan = 0;
+    }
+    D front(){
+        assert(!vals_in_window.empty());
+        return vals_in_window.front();
+    }
+    void push(const D& val){
+        this->count_push(val);
+        vals_in_window.push_back(val);
+        if (std::isnan(val)){
+            ++this->num_vals_nan;
+        } else {
+            ost.insert(val);
+            this->count_tree_op(true);
+            ++this->num_vals_notnan;
+        }
+    }
+    void pop(){
+        this->count_pop();
+        D val = front();
+        vals_in_window.pop_front();
+        if (std::isnan(val)){
+            --this->num_vals_nan;
+        } else {
+            ost.erase(ost.upper_bound(val));
+            this->count_tree_op();
+            --this->num_vals_notnan;
+        }
+    }
+};
+template <typename D>
+const std::string RollingOrderStatistics<D>::name = "RollingOrderStatistics";
+
+
+template <typename D>
+class RollingStreak : public RollingStatistics<D>{
+    /*
+     * length of the current run of consecutive values above threshold, e.g. of up moves for returns and threshold 0.
+     * the run ends at the newest value and is cut at the start of the window. NaN breaks runs like any other value.
+     * */
+protected:
+    std::deque<D> vals_in_window;
+    size_t tail_run = 0;  // number of values above threshold at the back, may reach beyond the window.
+    D compute_aux(){
+        return static_cast<D>(std::min(tail_run, this->size()));
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        writer.write<D>(threshold);
+        writer.write<uint64_t>(tail_run);
+        writer.write_container<D>(vals_in_window);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        threshold = reader.read<D>();
+        tail_run = static_cast<size_t>(reader.read<uint64_t>());
+        std::vector<D> vals = reader.read_array<D>();
+        vals_in_window = std::deque<D>(vals.begin(), vals.end());
+        if (vals_in_window.size() != this->size()) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    inline bool above(const D& val) const { return val > threshold; }  // false for NaN
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingStreak<D>& o = static_cast<RollingStreak<D>&>(other);
+        vals_in_window.swap(o.vals_in_window);
+        std::swap(tail_run, o.tail_run);
+        std::swap(threshold, o.threshold);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+    }
+public:
+    D threshold = 0.0;
+    explicit RollingStreak(D threshold_=0, bool skip_nan_=true){
+        threshold = threshold_;
+        this->skip_nan = skip_nan_;
+        clear();
+    }
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingStreak<D>(*this)); }
     void clear() {
         /* can be manually called or called by the constructor */
-        vals_in_window = std::queue<D>();
-        maximums = std::deque<D>();
+        vals_in_window = std::deque<D>();
+        tail_run = 0;
         this->num_vals_nan = 0;
         this->num_vals_notnan = 0;
     }
@@ -355,178 +2092,994 @@ public:
         return vals_in_window.front();
     }
     void push(const D& val){
-        vals_in_window.push(val);
+        this->count_push(val);
+        vals_in_window.push_back(val);
+        tail_run = above(val) ? tail_run + 1 : 0;
         if (std::isnan(val)){
             ++this->num_vals_nan;
         } else {
-            while (!maximums.empty() && maximums.back() < val){ maximums.pop_back(); }
-            maximums.push_back(val);
             ++this->num_vals_notnan;
         }
     }
     void pop(){
+        this->count_pop();
         D val = front();
-        vals_in_window.pop();
+        vals_in_window.pop_front();
         if (std::isnan(val)){
             --this->num_vals_nan;
         } else {
-            if (val == maximums.front()){ maximums.pop_front(); }
             --this->num_vals_notnan;
         }
     }
 };
 template <typename D>
-const std::string RollingMax<D>::name = "RollingMax";
+const std::string RollingStreak<D>::name = "RollingStreak";
 
 
 template <typename D>
-class RollingMin : public RollingStatistics<D>{
+class RollingMaxStreak : public RollingStreak<D>{
+    /*
+     * length of the longest run of consecutive values above threshold within the window.
+     * completed runs are kept in a deque of decreasing lengths like RollingMax: a run followed by a longer one can
+     * never be the maximum again. only the oldest run can be cut by the start of the window, so the maximum is
+     * found among the first two runs of the deque and the current run at the back.
+     * */
 protected:
-    std::queue<D> vals_in_window;
-    std::deque<D> minimums;
+    uint64_t num_pushed = 0;  // position of the next value, runs end at such positions.
+    std::deque<uint64_t> run_ends;  // completed runs cover [end - length, end).
+    std::deque<uint64_t> run_lengths;
     D compute_aux(){
-        return minimums.front();
+        uint64_t start = num_pushed - this->size();
+        size_t longest = std::min(this->tail_run, this->size());
+        if (!run_ends.empty()) {
+            longest = std::max(longest, static_cast<size_t>(std::min(run_lengths[0], run_ends[0] - start)));
+        }
+        if (run_ends.size() > 1) {
+            longest = std::max(longest, static_cast<size_t>(run_lengths[1]));
+        }
+        return static_cast<D>(longest);
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        RollingStreak<D>::serialize_aux(writer);
+        writer.write<uint64_t>(num_pushed);
+        writer.write_container<uint64_t>(run_ends);
+        writer.write_container<uint64_t>(run_lengths);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        RollingStreak<D>::deserialize_aux(reader);
+        num_pushed = reader.read<uint64_t>();
+        std::vector<uint64_t> ends = reader.read_array<uint64_t>();
+        std::vector<uint64_t> lengths = reader.read_array<uint64_t>();
+        if (ends.size() != lengths.size() || num_pushed < this->size()) {
+            throw std::runtime_error("RS::deserialize: inconsistent runs");
+        }
+        run_ends = std::deque<uint64_t>(ends.begin(), ends.end());
+        run_lengths = std::deque<uint64_t>(lengths.begin(), lengths.end());
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingStreak<D>::swap_aux(other);
+        RollingMaxStreak<D>& o = static_cast<RollingMaxStreak<D>&>(other);
+        std::swap(num_pushed, o.num_pushed);
+        run_ends.swap(o.run_ends);
+        run_lengths.swap(o.run_lengths);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        RollingStreak<D>::memory_usage_aux(usage);
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, run_ends);
+        add_memory_usage(usage, run_lengths);
     }
 public:
-    explicit RollingMin(bool skip_nan_=true){ this->skip_nan = skip_nan_; clear(); }
+    explicit RollingMaxStreak(D threshold_=0, bool skip_nan_=true): RollingStreak<D>(threshold_, skip_nan_){ clear(); }
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingMaxStreak<D>(*this)); }
     void clear() {
-        /* can be manually called or called by the constructor */
-        vals_in_window = std::queue<D>();
-        minimums = std::deque<D>();
-        this->num_vals_nan = 0;
-        this->num_vals_notnan = 0;
-    }
-    D front(){
-        assert(!vals_in_window.empty());
-        return vals_in_window.front();
+        RollingStreak<D>::clear();
+        num_pushed = 0;
+        run_ends = std::deque<uint64_t>();
+        run_lengths = std::deque<uint64_t>();
     }
     void push(const D& val){
-        vals_in_window.push(val);
-        if (std::isnan(val)){
-            ++this->num_vals_nan;
-        } else {
-            while (!minimums.empty() && minimums.back() > val){ minimums.pop_back(); }
-            minimums.push_back(val);
-            ++this->num_vals_notnan;
+        if (!this->above(val) && this->tail_run > 0) {
+            // the run at the back is completed, drop the shorter runs before it.
+            while (!run_lengths.empty() && run_lengths.back() <= this->tail_run) {
+                run_ends.pop_back();
+                run_lengths.pop_back();
+            }
+            run_ends.push_back(num_pushed);
+            run_lengths.push_back(this->tail_run);
         }
+        RollingStreak<D>::push(val);
+        ++num_pushed;
     }
     void pop(){
-        D val = front();
-        vals_in_window.pop();
-        if (std::isnan(val)){
-            --this->num_vals_nan;
-        } else {
-            if (val == minimums.front()){ minimums.pop_front(); }
-            --this->num_vals_notnan;
+        RollingStreak<D>::pop();
+        uint64_t start = num_pushed - this->size();
+        if (!run_ends.empty() && run_ends.front() <= start) {
+            run_ends.pop_front();
+            run_lengths.pop_front();
         }
     }
 };
 template <typename D>
-const std::string RollingMin<D>::name = "RollingMin";
+const std::string RollingMaxStreak<D>::name = "RollingMaxStreak";
 
 
 template <typename D>
-class RollingRank : public RollingStatistics<D>{
+class RollingCountAbove : public RollingStatistics<D>{
+    /*
+     * number of values in the window above a threshold. a fixed threshold only needs a counter updated on push and
+     * pop. with dynamic, the values are also kept in an order statistics tree and the count is looked up on compute,
+     * so the threshold can move at every step (e.g. follow another rolling statistic) at O(log(n)) per update.
+     * set_threshold() without dynamic recounts the window.
+     * */
 protected:
     std::deque<D> vals_in_window;
-    order_statistics_tree<D> ost;
-    bool normalize = false;
+    order_statistics_tree<D> ost;  // only used if dynamic
+    size_t num_above = 0;  // only used if not dynamic
+    D threshold = 0.0;
+    bool dynamic = false;
+    size_t count_above() {
+        if (!dynamic) { return num_above; }
+        // as val > threshold: nothing is above +inf or NaN, and nextafter() below could not step past +inf.
+        if (!(threshold < std::numeric_limits<D>::infinity())) { return 0; }
+        // order_of_key() counts the values strictly below its argument, i.e. those <= threshold here.
+        this->count_tree_op();
+        return ost.size() - ost.order_of_key(std::nextafter(threshold, std::numeric_limits<D>::infinity()));
+    }
     D compute_aux(){
-        D val = ost.order_of_key(vals_in_window.back());
-        if (normalize){ val /= this->num_vals_notnan; }
-        return val;
+        return static_cast<D>(count_above());
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        writer.write<uint8_t>(dynamic);
+        writer.write<D>(threshold);
+        writer.write_container<D>(vals_in_window);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        /* the counter or the tree is rebuilt from the window. */
+        dynamic = reader.read<uint8_t>() != 0;
+        threshold = reader.read<D>();
+        std::vector<D> vals = reader.read_array<D>();
+        vals_in_window = std::deque<D>(vals.begin(), vals.end());
+        for (size_t i = 0; i != vals.size(); ++i) {
+            if (std::isnan(vals[i])) { continue; }
+            if (dynamic) { ost.insert(vals[i]); }
+            else { num_above += vals[i] > threshold; }
+        }
+        if (vals_in_window.size() != this->size()) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingCountAbove<D>& o = static_cast<RollingCountAbove<D>&>(other);
+        vals_in_window.swap(o.vals_in_window);
+        ost.swap(o.ost);
+        std::swap(num_above, o.num_above);
+        std::swap(threshold, o.threshold);
+        std::swap(dynamic, o.dynamic);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+        add_memory_usage(usage, ost);
     }
 public:
-    explicit RollingRank(bool skip_nan_=true, bool normalize_=false){ this->skip_nan = skip_nan_; normalize = normalize_; clear(); }
+    explicit RollingCountAbove(D threshold_, bool skip_nan_=true, bool dynamic_=false){
+        threshold = threshold_;
+        this->skip_nan = skip_nan_;
+        dynamic = dynamic_;
+        clear();
+    }
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingCountAbove<D>(*this)); }
     void clear() {
         /* can be manually called or called by the constructor */
         vals_in_window = std::deque<D>();
         ost = order_statistics_tree<D>();
+        num_above = 0;
         this->num_vals_nan = 0;
         this->num_vals_notnan = 0;
     }
+    inline D get_threshold() const { return threshold; }
+    void set_threshold(D threshold_){
+        threshold = threshold_;
+        if (!dynamic) {
+            num_above = 0;
+            for (size_t i = 0; i != vals_in_window.size(); ++i) {
+                num_above += vals_in_window[i] > threshold;
+            }
+        }
+    }
     D front(){
         assert(!vals_in_window.empty());
         return vals_in_window.front();
     }
     void push(const D& val){
+        this->count_push(val);
         vals_in_window.push_back(val);
         if (std::isnan(val)){
             ++this->num_vals_nan;
         } else {
-            ost.insert(val);
+            if (dynamic) { ost.insert(val); this->count_tree_op(true); }
+            else { num_above += val > threshold; }
             ++this->num_vals_notnan;
         }
     }
     void pop(){
+        this->count_pop();
         D val = front();
         vals_in_window.pop_front();
         if (std::isnan(val)){
             --this->num_vals_nan;
         } else {
-            ost.erase(ost.upper_bound(val));
+            if (dynamic) { ost.erase(ost.upper_bound(val)); this->count_tree_op(); }
+            else { num_above -= val > threshold; }
             --this->num_vals_notnan;
         }
     }
 };
 template <typename D>
-const std::string RollingRank<D>::name = "RollingRank";
+const std::string RollingCountAbove<D>::name = "RollingCountAbove";
 
 
 template <typename D>
-class RollingOrderStatistics : public RollingStatistics<D>{
+class RollingFractionAbove : public RollingCountAbove<D>{
+    /* the fraction of non-NaN values in the window above a threshold. */
+protected:
+    D compute_aux(){
+        return static_cast<D>(this->count_above()) / static_cast<D>(this->num_vals_notnan);
+    }
+public:
+    explicit RollingFractionAbove(D threshold_, bool skip_nan_=true, bool dynamic_=false): RollingCountAbove<D>(threshold_, skip_nan_, dynamic_){}
+    static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingFractionAbove<D>(*this)); }
+};
+template <typename D>
+const std::string RollingFractionAbove<D>::name = "RollingFractionAbove";
+
+
+template <typename D>
+class RollingEntropy : public RollingStatistics<D>{
+    /*
+     * Shannon entropy (in nats) of the histogram of the window, over num_bins equal bins on [lower, upper).
+     * values outside go to the first or last bin. with n values and bin counts c, H = log(n) - sum(c * log(c)) / n,
+     * where the sum changes by one term on each push and pop. it is accumulated in double and recomputed from the
+     * counts every RECOUNT_PERIOD updates, so rounding errors do not build up.
+     * */
 protected:
+    static const size_t RECOUNT_PERIOD = 1 << 16;
     std::deque<D> vals_in_window;
-    order_statistics_tree<D> ost;
+    std::vector<size_t> counts;
+    double sum_clogc = 0;  // sum(c * log(c)) over all bins
+    size_t num_updates = 0;  // since sum_clogc was last recomputed
+    size_t num_bins = 1;
+    D lower = 0.0;
+    D upper = 1.0;
     bool normalize = false;
+    static inline double clogc(size_t c) { return c > 1 ? static_cast<double>(c) * std::log(static_cast<double>(c)) : 0.0; }
+    inline size_t bin(const D& val) const {
+        double pos = (static_cast<double>(val) - lower) / (static_cast<double>(upper) - lower) * static_cast<double>(num_bins);
+        if (!(pos > 0)) { return 0; }
+        if (!(pos < static_cast<double>(num_bins))) { return num_bins - 1; }  // clamp before the cast, e.g. +inf
+        return std::min(num_bins - 1, static_cast<size_t>(pos));
+    }
+    void update(const D& val, bool add) {
+        size_t& c = counts[bin(val)];
+        double before = clogc(c);
+        c = add ? c + 1 : c - 1;
+        sum_clogc += clogc(c) - before;
+        if (++num_updates == RECOUNT_PERIOD) { recount(); }
+    }
+    void check_same_bins(const RollingEntropy<D>& other) const {
+        if (other.num_bins != num_bins || other.lower != lower || other.upper != upper) {
+            throw std::invalid_argument("RS::merge: cannot combine histograms with different bins");
+        }
+    }
+    void recount() {
+        sum_clogc = 0;
+        for (size_t b = 0; b != num_bins; ++b) {
+            sum_clogc += clogc(counts[b]);
+        }
+        num_updates = 0;
+    }
     D compute_aux(){
-        size_t real_order = std::min(this->num_vals_notnan - 1, static_cast<size_t>(normalize ? order * this->num_vals_notnan: order));
-        return *(ost.find_by_order(real_order));
+        double n = static_cast<double>(this->num_vals_notnan);
+        double entropy = std::max(0.0, std::log(n) - sum_clogc / n);
+        if (normalize) { entropy = num_bins > 1 ? entropy / std::log(static_cast<double>(num_bins)) : 0.0; }
+        return static_cast<D>(entropy);
+    }
+    void serialize_aux(SerializationWriter& writer) const {
+        writer.write<uint64_t>(num_bins);
+        writer.write<D>(lower);
+        writer.write<D>(upper);
+        writer.write<uint8_t>(normalize);
+        writer.write_container<D>(vals_in_window);
+    }
+    void deserialize_aux(SerializationReader& reader) {
+        /* the histogram is rebuilt from the window. */
+        num_bins = static_cast<size_t>(reader.read<uint64_t>());
+        lower = reader.read<D>();
+        upper = reader.read<D>();
+        normalize = reader.read<uint8_t>() != 0;
+        if (num_bins == 0 || !(upper > lower)) {
+            throw std::runtime_error("RS::deserialize: invalid bins");
+        }
+        std::vector<D> vals = reader.read_array<D>();
+        vals_in_window = std::deque<D>(vals.begin(), vals.end());
+        counts.assign(num_bins, 0);
+        for (size_t i = 0; i != vals.size(); ++i) {
+            if (!std::isnan(vals[i])) { ++counts[bin(vals[i])]; }
+        }
+        recount();
+        if (vals_in_window.size() != this->size()) {
+            throw std::runtime_error("RS::deserialize: window size does not match counters");
+        }
+    }
+    void swap_aux(RollingStatistics<D>& other) {
+        RollingEntropy<D>& o = static_cast<RollingEntropy<D>&>(other);
+        vals_in_window.swap(o.vals_in_window);
+        counts.swap(o.counts);
+        std::swap(sum_clogc, o.sum_clogc);
+        std::swap(num_updates, o.num_updates);
+        std::swap(num_bins, o.num_bins);
+        std::swap(lower, o.lower);
+        std::swap(upper, o.upper);
+        std::swap(normalize, o.normalize);
+    }
+    void memory_usage_aux(MemoryUsage& usage) const {
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, vals_in_window);
+        add_memory_usage(usage, counts);
     }
 public:
-    D order = 0.0;
-    explicit RollingOrderStatistics(D order_, bool skip_nan_=true, bool normalize_=false){
-        order = order_;
+    RollingEntropy(size_t num_bins_, D lower_, D upper_, bool skip_nan_=true, bool normalize_=false){
+        if (num_bins_ == 0 || !(upper_ > lower_)) {
+            throw std::invalid_argument("RS::RollingEntropy: need num_bins > 0 and upper > lower");
+        }
+        num_bins = num_bins_;
+        lower = lower_;
+        upper = upper_;
         this->skip_nan = skip_nan_;
         normalize = normalize_;
         clear();
     }
     static const std::string name;
+    const std::string& class_name() const { return name; }
+    std::unique_ptr<RollingStatistics<D>> clone() const { return std::unique_ptr<RollingStatistics<D>>(new RollingEntropy<D>(*this)); }
     void clear() {
         /* can be manually called or called by the constructor */
         vals_in_window = std::deque<D>();
-        ost = order_statistics_tree<D>();
+        counts.assign(num_bins, 0);
+        sum_clogc = 0;
+        num_updates = 0;
         this->num_vals_nan = 0;
         this->num_vals_notnan = 0;
     }
+    const std::vector<size_t>& histogram() const { return counts; }
     D front(){
         assert(!vals_in_window.empty());
         return vals_in_window.front();
     }
     void push(const D& val){
+        this->count_push(val);
         vals_in_window.push_back(val);
         if (std::isnan(val)){
             ++this->num_vals_nan;
         } else {
-            ost.insert(val);
+            update(val, true);
             ++this->num_vals_notnan;
         }
     }
     void pop(){
+        this->count_pop();
         D val = front();
         vals_in_window.pop_front();
         if (std::isnan(val)){
             --this->num_vals_nan;
         } else {
-            ost.erase(ost.upper_bound(val));
+            update(val, false);
             --this->num_vals_notnan;
         }
     }
+    void merge(const RollingEntropy<D>& other){
+        /*
+         * combine with the window of other, as if its values were pushed after ours. the bin counts are added and
+         * sum(c * log(c)) is recomputed from them, in O(num_bins). both must have the same bins.
+         * */
+        check_same_bins(other);
+        vals_in_window.insert(vals_in_window.end(), other.vals_in_window.begin(), other.vals_in_window.end());
+        for (size_t b = 0; b != num_bins; ++b) { counts[b] += other.counts[b]; }
+        recount();
+        this->num_vals_nan += other.num_vals_nan;
+        this->num_vals_notnan += other.num_vals_notnan;
+    }
+    void subtract(const RollingEntropy<D>& other){
+        /* the inverse of merge(): remove the oldest other.size() values, which must be the window of other. */
+        check_same_bins(other);
+        assert(other.size() <= this->size());
+        vals_in_window.erase(vals_in_window.begin(), vals_in_window.begin() + static_cast<std::ptrdiff_t>(other.size()));
+        for (size_t b = 0; b != num_bins; ++b) {
+            assert(counts[b] >= other.counts[b]);
+            counts[b] -= other.counts[b];
+        }
+        recount();
+        this->num_vals_nan -= other.num_vals_nan;
+        this->num_vals_notnan -= other.num_vals_notnan;
+    }
 };
 template <typename D>
-const std::string RollingOrderStatistics<D>::name = "RollingOrderStatistics";
+const std::string RollingEntropy<D>::name = "RollingEntropy";
+
+
+template <typename T>
+class RollingBitStatistics{
+    /*
+     * An abstract class for rolling statistics of bool or uint8_t signals, e.g. up-tick flags.
+     * the window is a ring of bits with one bit plane per bit of T, so a bool window takes 1/32 of a float one.
+     * there are no NaNs, compute() returns NaN only for an empty window.
+     * */
+protected:
+    static const size_t NUM_PLANES = std::is_same<T, bool>::value ? 1 : 8 * sizeof(T);
+    std::vector<std::vector<uint64_t>> planes;  // NUM_PLANES rings of the same number of words, a power of 2.
+    size_t head = 0;  // bit position of the oldest value.
+    size_t num_vals = 0;
+    uint64_t total = 0;  // sum of the values in the window.
+    size_t num_nonzero = 0;
+    virtual double compute_aux(uint64_t sum, size_t count, size_t size) const = 0;  // from the window sum, nonzero count and size.
+
+    inline size_t capacity() const { return planes[0].size() * 64; }
+    inline T get(size_t pos) const {
+        uint64_t val = 0;
+        for (size_t b = 0; b != NUM_PLANES; ++b) {
+            val |= ((planes[b][pos / 64] >> (pos % 64)) & 1) << b;
+        }
+        return static_cast<T>(val);
+    }
+    inline void set(size_t pos, T val) {
+        for (size_t b = 0; b != NUM_PLANES; ++b) {
+            uint64_t mask = static_cast<uint64_t>(1) << (pos % 64);
+            if ((static_cast<uint64_t>(val) >> b) & 1) { planes[b][pos / 64] |= mask; }
+            else { planes[b][pos / 64] &= ~mask; }
+        }
+    }
+    void grow() {
+        /* doubles the ring, moving the window to the start. */
+        std::vector<T> vals(num_vals);
+        for (size_t i = 0; i != num_vals; ++i) {
+            vals[i] = get((head + i) & (capacity() - 1));
+        }
+        size_t num_words = planes[0].size() * 2;
+        planes.assign(NUM_PLANES, std::vector<uint64_t>(num_words, 0));
+        head = 0;
+        for (size_t i = 0; i != num_vals; ++i) {
+            set(i, vals[i]);
+        }
+    }
+    static inline size_t rank(const std::vector<uint64_t>& words, const std::vector<size_t>& prefix, size_t m) {
+        /* number of set bits among the first m. */
+        uint64_t mask = (static_cast<uint64_t>(1) << (m % 64)) - 1;
+        return prefix[m / 64] + static_cast<size_t>(__builtin_popcountll(words[m / 64] & mask));
+    }
+public:
+    RollingBitStatistics(){ clear(); }
+    virtual ~RollingBitStatistics() {}
+    void clear() {
+        planes.assign(NUM_PLANES, std::vector<uint64_t>(1, 0));
+        head = 0;
+        num_vals = 0;
+        total = 0;
+        num_nonzero = 0;
+    }
+    inline size_t size() const { return num_vals; }
+    inline uint64_t sum() const { return total; }
+    inline size_t count() const { return num_nonzero; }
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, planes);
+        for (size_t b = 0; b != NUM_PLANES; ++b) {
+            add_memory_usage(usage, planes[b]);
+        }
+        return usage;
+    }
+    T front() const {
+        assert(num_vals > 0);
+        return get(head);
+    }
+    void push(const T& val) {
+        if (num_vals == capacity()) { grow(); }
+        set((head + num_vals) & (capacity() - 1), val);
+        total += static_cast<uint64_t>(val);
+        num_nonzero += val != 0;
+        ++num_vals;
+    }
+    void pop() {
+        T val = front();
+        total -= static_cast<uint64_t>(val);
+        num_nonzero -= val != 0;
+        head = (head + 1) & (capacity() - 1);
+        --num_vals;
+    }
+    double compute() const {
+        if (num_vals == 0) { return NAN; }
+        return compute_aux(total, num_nonzero, num_vals);
+    }
+
+    template <typename D>
+    void roll_ndarray(const T* ptr_in, D* ptr_out, const std::vector<size_t>& shape, size_t axis, size_t window, size_t min_periods, std::vector<size_t> strides_in={}, std::vector<size_t> strides_out={}) const {
+        /*
+         * rolls the signal ptr_in into ptr_out of the same shape, NaN where a window has fewer than min_periods values.
+         * each lane is packed into bit planes with running popcounts per word, so the sums over any window are a
+         * difference of two popcounts, without a dependency from one cell to the next. the window of this object is unused.
+         * */
+        size_t ndim = shape.size();
+        assert(ndim > 0);
+        assert(axis < ndim);
+        size_t size_arr = 1;
+        for (size_t i = 0; i != ndim; ++i) {
+            size_arr *= shape[i];
+        }
+        if (size_arr == 0) { return; }
+        std::vector<size_t> strides_c(ndim, 1);
+        for (size_t i = ndim - 1; i > 0; --i) {
+            strides_c[i - 1] = strides_c[i] * shape[i];
+        }
+        if (strides_in.empty()) { strides_in = strides_c; }
+        if (strides_out.empty()) { strides_out = strides_c; }
+        assert(strides_in.size() == ndim && strides_out.size() == ndim);
+
+        size_t len_lane = shape[axis];
+        size_t num_words = len_lane / 64 + 1;
+        size_t num_planes = NUM_PLANES + (NUM_PLANES > 1);  // the last one marks nonzero values
+        std::vector<std::vector<uint64_t>> words(num_planes, std::vector<uint64_t>(num_words));
+        std::vector<std::vector<size_t>> prefix(num_planes, std::vector<size_t>(num_words));
+        std::vector<size_t> lanes_in = lane_offsets(shape, axis, strides_in);
+        std::vector<size_t> lanes_out = lane_offsets(shape, axis, strides_out);
+        for (size_t lane = 0; lane != lanes_in.size(); ++lane) {
+            const T* ptr_lane = ptr_in + lanes_in[lane];
+            for (size_t p = 0; p != num_planes; ++p) {
+                std::fill(words[p].begin(), words[p].end(), 0);
+            }
+            for (size_t i = 0; i != len_lane; ++i) {
+                uint64_t val = static_cast<uint64_t>(ptr_lane[i * strides_in[axis]]);
+                for (size_t b = 0; b != NUM_PLANES; ++b) {
+                    words[b][i / 64] |= ((val >> b) & 1) << (i % 64);
+                }
+                if (NUM_PLANES > 1) {
+                    words[NUM_PLANES][i / 64] |= static_cast<uint64_t>(val != 0) << (i % 64);
+                }
+            }
+            for (size_t p = 0; p != num_planes; ++p) {
+                size_t running = 0;
+                for (size_t k = 0; k != num_words; ++k) {
+                    prefix[p][k] = running;
+                    running += static_cast<size_t>(__builtin_popcountll(words[p][k]));
+                }
+            }
+            D* ptr_cell = ptr_out + lanes_out[lane];
+            for (size_t i = 0; i != len_lane; ++i) {
+                size_t end = i + 1;
+                size_t begin = end > window ? end - window : 0;
+                if (end - begin < min_periods || end == begin) {
+                    *ptr_cell = NAN;
+                }
+                else {
+                    uint64_t sum = 0;
+                    for (size_t b = 0; b != NUM_PLANES; ++b) {
+                        sum += static_cast<uint64_t>(rank(words[b], prefix[b], end) - rank(words[b], prefix[b], begin)) << b;
+                    }
+                    size_t nonzero = rank(words[num_planes - 1], prefix[num_planes - 1], end)
+                                     - rank(words[num_planes - 1], prefix[num_planes - 1], begin);
+                    *ptr_cell = static_cast<D>(compute_aux(sum, nonzero, end - begin));
+                }
+                ptr_cell += strides_out[axis];
+            }
+        }
+    }
+};
+
+
+template <typename T>
+class RollingBitCount : public RollingBitStatistics<T>{
+    /* the number of nonzero (true) values in the window. */
+protected:
+    double compute_aux(uint64_t, size_t count, size_t) const { return static_cast<double>(count); }
+public:
+    static const std::string name;
+};
+template <typename T>
+const std::string RollingBitCount<T>::name = "RollingBitCount";
+
+
+template <typename T>
+class RollingBitSum : public RollingBitStatistics<T>{
+    /* the sum of the window, the same as RollingBitCount for bool. */
+protected:
+    double compute_aux(uint64_t sum, size_t, size_t) const { return static_cast<double>(sum); }
+public:
+    static const std::string name;
+};
+template <typename T>
+const std::string RollingBitSum<T>::name = "RollingBitSum";
+
+
+template <typename T>
+class RollingBitMean : public RollingBitStatistics<T>{
+    /* the mean of the window, i.e. the fraction of true values for bool. */
+protected:
+    double compute_aux(uint64_t sum, size_t, size_t size) const { return static_cast<double>(sum) / static_cast<double>(size); }
+public:
+    static const std::string name;
+};
+template <typename T>
+const std::string RollingBitMean<T>::name = "RollingBitMean";
+
+
+/*
+ * what RollingRollup keeps of a pane of Class. the moment classes run on a CountingWindow, so a pane holds its sums
+ * and counts only, and RollingMax/RollingMin collapse a closed pane into its extreme. either way no level above
+ * the current pane of the finest one holds raw values.
+ * */
+template <class Class>
+struct RollupPane;  // no other class can be rolled up
+
+template <typename D, class Window>
+struct RollupPane<RollingMean<D, Window>> { typedef RollingMean<D, CountingWindow<D>> type; };
+template <typename D, class Window>
+struct RollupPane<RollingVariance<D, Window>> { typedef RollingVariance<D, CountingWindow<D>> type; };
+template <typename D, class Window>
+struct RollupPane<RollingSkewness<D, Window>> { typedef RollingSkewness<D, CountingWindow<D>> type; };
+template <typename D, class Window>
+struct RollupPane<RollingZScore<D, Window>> { typedef RollingZScore<D, CountingWindow<D>> type; };
+template <typename D, class Window>
+struct RollupPane<RollingMax<D, Window>> { typedef RollingMax<D, Window> type; };
+template <typename D, class Window>
+struct RollupPane<RollingMin<D, Window>> { typedef RollingMin<D, Window> type; };
+
+template <typename D, class Window>
+inline void collapse_pane(RollingMomentStatistics<D, Window>&) {}  // the sums are all there is
+
+template <typename D, class Extreme>
+void collapse_extreme_pane(Extreme& pane) {
+    /* the extreme of a pane is all that coarser windows need, NaN if compute() gives NaN. */
+    if (pane.size() > 1) {
+        D val = pane.compute();
+        pane.clear();
+        pane.push(val);
+    }
+}
+
+template <typename D, class Window>
+inline void collapse_pane(RollingMax<D, Window>& pane) { collapse_extreme_pane<D>(pane); }
+
+template <typename D, class Window>
+inline void collapse_pane(RollingMin<D, Window>& pane) { collapse_extreme_pane<D>(pane); }
+
+
+template <typename D, class Class>
+class RollingRollup{
+    /*
+     * rolling statistics of one stream at several time resolutions, e.g. pane lengths {1, 60, 3600} seconds.
+     * level l groups values into panes of pane_lengths[l] time units and keeps a rolling window over its last
+     * windows[l] completed panes. only the finest level sees raw values: a completed fine pane is merge()d into
+     * the current pane of the next level, and a window drops its oldest pane with subtract(). panes are of type
+     * Pane (see RollupPane), which keeps sums and counts or extremes instead of values, so memory does not grow
+     * with the rate of values. Class must be a moment class or RollingMax/RollingMin.
+     *
+     *     push(t, x) -> partial pane (level 0) --close--> window 0
+     *                                          \--merge--> partial pane (level 1) --close--> window 1 ...
+     * */
+public:
+    typedef typename RollupPane<Class>::type Pane;
+protected:
+    struct Level{
+        int64_t pane_length;
+        size_t window;  // number of panes
+        int64_t current_pane;  // index of the pane being filled, time / pane_length
+        Pane partial;  // values of the current pane
+        Pane rolling;  // merge of the panes in 'panes'
+        std::deque<Pane> panes;  // completed panes in the window, oldest first
+        Level(int64_t pane_length_, size_t window_, const Pane& prototype):
+            pane_length(pane_length_), window(window_), current_pane(0), partial(prototype), rolling(prototype) {}
+    };
+    std::vector<Level> levels;
+    bool started = false;
+
+    static int64_t floor_div(int64_t a, int64_t b) {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)) ? 1 : 0);
+    }
+    void close_pane(size_t l) {
+        /* moves the current pane of level l into its window and into the current pane of level l + 1. */
+        Level& level = levels[l];
+        collapse_pane(level.partial);
+        level.rolling.merge(level.partial);
+        level.panes.push_back(level.partial);
+        if (level.panes.size() > level.window) {
+            level.rolling.subtract(level.panes.front());
+            level.panes.pop_front();
+        }
+        if (l + 1 < levels.size()) {
+            advance_level(l + 1, floor_div(level.current_pane * level.pane_length, levels[l + 1].pane_length));
+            levels[l + 1].partial.merge(level.partial);
+        }
+        level.partial.clear();
+        ++level.current_pane;
+    }
+    void advance_level(size_t l, int64_t pane) {
+        /* closes all panes of level l before 'pane'. */
+        Level& level = levels[l];
+        while (level.current_pane < pane) {
+            if (level.partial.size() == 0 && pane - level.current_pane > static_cast<int64_t>(level.window)) {
+                // only empty panes are left until the window is entirely replaced, skip them.
+                level.rolling.clear();
+                level.panes.clear();
+                level.current_pane = pane - static_cast<int64_t>(level.window);
+            }
+            close_pane(l);
+        }
+    }
+
+public:
+    template <typename... Args>
+    RollingRollup(const std::vector<int64_t>& pane_lengths, const std::vector<size_t>& windows, Args&&... args) {
+        /* pane lengths must be increasing multiples of each other. args are forwarded to every Class. */
+        assert(!pane_lengths.empty() && pane_lengths.size() == windows.size());
+        Pane prototype(std::forward<Args>(args)...);
+        for (size_t l = 0; l != pane_lengths.size(); ++l) {
+            if (pane_lengths[l] <= 0 || (l > 0 && pane_lengths[l] % pane_lengths[l - 1] != 0)) {
+                throw std::invalid_argument("RS::RollingRollup: each pane length must be a positive multiple of the previous one");
+            }
+            levels.push_back(Level(pane_lengths[l], windows[l], prototype));
+        }
+    }
+    void clear() {
+        for (size_t l = 0; l != levels.size(); ++l) {
+            levels[l].partial.clear();
+            levels[l].rolling.clear();
+            levels[l].panes.clear();
+        }
+        started = false;
+    }
+    void advance(int64_t time) {
+        /* closes every pane that ends at or before 'time', at all levels. time must not decrease. */
+        if (!started) {
+            for (size_t l = 0; l != levels.size(); ++l) {
+                levels[l].current_pane = floor_div(time, levels[l].pane_length);
+            }
+            started = true;
+        }
+        for (size_t l = 0; l != levels.size(); ++l) {
+            advance_level(l, floor_div(time, levels[l].pane_length));
+        }
+    }
+    void push(int64_t time, const D& val) {
+        advance(time);
+        levels[0].partial.push(val);
+    }
+    inline size_t num_levels() const { return levels.size(); }
+    inline int64_t pane_length(size_t level) const { return levels[level].pane_length; }
+    inline Pane& window(size_t level) { return levels[level].rolling; }  // the last windows[level] completed panes
+    inline D compute(size_t level) { return levels[level].rolling.compute(); }
+    MemoryUsage memory_usage() const {
+        /* the levels and panes count as objects, the windows they hold as buffers. */
+        MemoryUsage usage;
+        usage.object_bytes = sizeof(*this) + levels.capacity() * sizeof(Level);
+        usage.overhead_bytes = MALLOC_OVERHEAD;
+        for (size_t l = 0; l != levels.size(); ++l) {
+            const Level& level = levels[l];
+            add_contained_memory_usage(usage, level.partial);
+            add_contained_memory_usage(usage, level.rolling);
+            MemoryUsage panes;
+            add_memory_usage(panes, level.panes);
+            usage.object_bytes += panes.buffer_bytes;
+            usage.overhead_bytes += panes.overhead_bytes;
+            for (size_t p = 0; p != level.panes.size(); ++p) {
+                add_contained_memory_usage(usage, level.panes[p]);
+            }
+        }
+        return usage;
+    }
+};
+
+
+/*
+ * latency of the streaming path. LatencyClock reads steady_clock, or the time stamp counter if compiled with
+ * -DRS_LATENCY_RDTSC on x86, which is cheaper to read and is converted to nanoseconds with a rate measured once.
+ * */
+struct LatencyClock{
+#ifdef RS_HAS_RDTSC
+    static inline uint64_t now() { return __rdtsc(); }
+    static double ticks_per_ns() {
+        static const double rate = []() {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            uint64_t ticks = __rdtsc();
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10)) {}
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            return static_cast<double>(__rdtsc() - ticks) / ns;
+        }();
+        return rate;
+    }
+    static inline uint64_t to_ns(uint64_t ticks) { return static_cast<uint64_t>(static_cast<double>(ticks) / ticks_per_ns()); }
+#else
+    static inline uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    static inline uint64_t to_ns(uint64_t ticks) { return ticks; }
+#endif
+};
+
+
+class LatencyHistogram{
+    /*
+     * HDR-style histogram of latencies in nanoseconds. values below 2^SUB_BITS are counted exactly, each power of 2
+     * above is split into 2^(SUB_BITS - 1) linear buckets, so percentiles are within 1 / 2^(SUB_BITS - 1) of the true
+     * value, from nanoseconds to hours. recording is a few instructions and never allocates.
+     * */
+protected:
+    static const unsigned SUB_BITS = 7;
+    static const uint64_t HALF = static_cast<uint64_t>(1) << (SUB_BITS - 1);
+    std::vector<uint64_t> counts;
+    uint64_t num_vals = 0;
+    uint64_t sum = 0;
+    uint64_t min_val = std::numeric_limits<uint64_t>::max();
+    uint64_t max_val = 0;
+
+    static inline size_t bucket(uint64_t val) {
+        if (val < 2 * HALF) { return static_cast<size_t>(val); }
+        unsigned shift = 63 - static_cast<unsigned>(__builtin_clzll(val)) - (SUB_BITS - 1);
+        return static_cast<size_t>(shift * HALF + (val >> shift));
+    }
+    static inline uint64_t bucket_upper(size_t index) {
+        /* the largest value of a bucket, reported for its percentiles as in HdrHistogram. */
+        if (index < 2 * HALF) { return index; }
+        uint64_t shift = index / HALF - 1;
+        uint64_t sub = index % HALF + HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+public:
+    LatencyHistogram(): counts((64 - SUB_BITS + 2) * HALF, 0) {}
+    void clear() {
+        std::fill(counts.begin(), counts.end(), 0);
+        num_vals = 0;
+        sum = 0;
+        min_val = std::numeric_limits<uint64_t>::max();
+        max_val = 0;
+    }
+    inline void record(uint64_t ns) {
+        ++counts[bucket(ns)];
+        ++num_vals;
+        sum += ns;
+        min_val = std::min(min_val, ns);
+        max_val = std::max(max_val, ns);
+    }
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i != counts.size(); ++i) { counts[i] += other.counts[i]; }
+        num_vals += other.num_vals;
+        sum += other.sum;
+        min_val = std::min(min_val, other.min_val);
+        max_val = std::max(max_val, other.max_val);
+    }
+    inline uint64_t count() const { return num_vals; }
+    inline uint64_t min() const { return num_vals > 0 ? min_val : 0; }
+    inline uint64_t max() const { return max_val; }
+    inline double mean() const { return num_vals > 0 ? static_cast<double>(sum) / static_cast<double>(num_vals) : NAN; }
+    uint64_t percentile(double q) const {
+        /* the smallest bucket below which a fraction q of the values fall, e.g. q = 0.999. 0 if empty. */
+        assert(q >= 0 && q <= 1);
+        if (num_vals == 0) { return 0; }
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(num_vals))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i != counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) { return std::min(bucket_upper(i), max_val); }
+        }
+        return max_val;
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> buckets() const {
+        /* (largest value, count) of every nonempty bucket, e.g. to plot the distribution or spot a second mode. */
+        std::vector<std::pair<uint64_t, uint64_t>> result;
+        for (size_t i = 0; i != counts.size(); ++i) {
+            if (counts[i] > 0) { result.push_back(std::make_pair(bucket_upper(i), counts[i])); }
+        }
+        return result;
+    }
+};
+
+
+template <typename D>
+class LatencyRecorder{
+    /*
+     * forwards push(), pop() and compute() to an accumulator and times every sample_every-th call of each into
+     * a LatencyHistogram, to see the tail per tick rather than the average. the accumulator must outlive this.
+     * a timed call costs two clock reads on top, about 20ns with steady_clock and 10ns with RS_LATENCY_RDTSC,
+     * which sample_every spreads over that many calls. spikes in the tail of push() are allocations of deque
+     * chunks or tree nodes, and rebalancing of the order statistics tree.
+     * */
+public:
+    enum Op{ PUSH = 0, POP = 1, COMPUTE = 2, NUM_OPS = 3 };
+protected:
+    RollingStatistics<D>& rs;
+    size_t sample_every;
+    size_t num_calls[NUM_OPS] = {0, 0, 0};
+    LatencyHistogram histograms[NUM_OPS];
+    inline bool sampled(Op op) {
+        if (++num_calls[op] < sample_every) { return false; }
+        num_calls[op] = 0;
+        return true;
+    }
+public:
+    explicit LatencyRecorder(RollingStatistics<D>& rs_, size_t sample_every_=1): rs(rs_), sample_every(std::max<size_t>(1, sample_every_)) {}
+    inline RollingStatistics<D>& accumulator() { return rs; }
+    void push(const D& val) {
+        if (!sampled(PUSH)) { rs.push(val); return; }
+        uint64_t start = LatencyClock::now();
+        rs.push(val);
+        histograms[PUSH].record(LatencyClock::to_ns(LatencyClock::now() - start));
+    }
+    void pop() {
+        if (!sampled(POP)) { rs.pop(); return; }
+        uint64_t start = LatencyClock::now();
+        rs.pop();
+        histograms[POP].record(LatencyClock::to_ns(LatencyClock::now() - start));
+    }
+    D compute() {
+        if (!sampled(COMPUTE)) { return rs.compute(); }
+        uint64_t start = LatencyClock::now();
+        D val = rs.compute();
+        histograms[COMPUTE].record(LatencyClock::to_ns(LatencyClock::now() - start));
+        return val;
+    }
+    inline const LatencyHistogram& histogram(Op op) const { return histograms[op]; }
+    void clear() {
+        /* resets the histograms, not the accumulator. */
+        for (size_t op = 0; op != NUM_OPS; ++op) {
+            num_calls[op] = 0;
+            histograms[op].clear();
+        }
+    }
+};
+
+
+/*
+ * the compiled part of the library (src/rolling_statistics.cpp, the rolling_statistics_kernels target in CMake)
+ * holds every class for float and double and the block kernels of every SIMD level. targets that link it get
+ * RS_COMPILED_KERNELS, under which these are only declared here, so each translation unit does not compile them
+ * again. other value types and Window containers are still instantiated from the header.
+ * */
+#define RS_INSTANTIATE_CLASSES(PREFIX, D) \
+    PREFIX template class RollingStatistics<D>; \
+    PREFIX template class RollingMomentStatistics<D>; \
+    PREFIX template class RollingMean<D>; \
+    PREFIX template class RollingVariance<D>; \
+    PREFIX template class RollingSkewness<D>; \
+    PREFIX template class RollingZScore<D>; \
+    PREFIX template class RollingMax<D>; \
+    PREFIX template class RollingMin<D>; \
+    PREFIX template class RollingRank<D>; \
+    PREFIX template class RollingOrderStatistics<D>; \
+    PREFIX template class RollingStreak<D>; \
+    PREFIX template class RollingMaxStreak<D>; \
+    PREFIX template class RollingCountAbove<D>; \
+    PREFIX template class RollingFractionAbove<D>; \
+    PREFIX template class RollingEntropy<D>; \
+    PREFIX template void roll_block_kernel_baseline<D>(BlockKernel, D*, size_t, size_t, size_t, size_t, size_t, bool);
+#ifdef RS_HAS_SIMD_DISPATCH
+#define RS_INSTANTIATE_KERNELS(PREFIX, D) \
+    PREFIX template void roll_block_kernel_avx2<D>(BlockKernel, D*, size_t, size_t, size_t, size_t, size_t, bool); \
+    PREFIX template void roll_block_kernel_avx512<D>(BlockKernel, D*, size_t, size_t, size_t, size_t, size_t, bool);
+#else
+#define RS_INSTANTIATE_KERNELS(PREFIX, D)
+#endif
+
+#ifdef RS_COMPILED_KERNELS
+RS_INSTANTIATE_CLASSES(extern, float)
+RS_INSTANTIATE_CLASSES(extern, double)
+RS_INSTANTIATE_KERNELS(extern, float)
+RS_INSTANTIATE_KERNELS(extern, double)
+#endif
 
 
 
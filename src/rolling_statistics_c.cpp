@@ -0,0 +1,273 @@
+/*
+ * the C ABI of rolling_statistics_c.h. a handle owns one RollingStatistics<float> or <double>, and every entry
+ * point catches exceptions and turns them into a status and the thread's last error.
+ * */
+
+#define RS_C_BUILDING
+#include "rolling_statistics_c.h"
+#include "rolling_statistics.hpp"
+
+struct rs_handle{
+    int dtype;
+    std::unique_ptr<RS::RollingStatistics<float>> f32;
+    std::unique_ptr<RS::RollingStatistics<double>> f64;
+};
+
+
+namespace {
+
+thread_local std::string last_error;
+
+int fail(int status, const std::string& message) {
+    last_error = message;
+    return status;
+}
+
+template <typename F>
+int guarded(F f) {
+    /* runs f, which returns a status, and reports whatever it throws. */
+    try {
+        return f();
+    } catch (const std::invalid_argument& e) {
+        return fail(RS_ERROR_INVALID_ARGUMENT, e.what());
+    } catch (const std::exception& e) {
+        return fail(RS_ERROR_RUNTIME, e.what());
+    } catch (...) {
+        return fail(RS_ERROR_RUNTIME, "unknown exception");
+    }
+}
+
+double param(const double* params, size_t num_params, size_t i, double fallback) {
+    return i < num_params ? params[i] : fallback;
+}
+
+double required_param(const double* params, size_t num_params, size_t i, const char* name) {
+    if (i >= num_params) { throw std::invalid_argument(std::string("rs_create: missing parameter ") + name); }
+    return params[i];
+}
+
+template <typename D>
+std::unique_ptr<RS::RollingStatistics<D>> make_statistic(int statistic, bool skip_nan, const double* params, size_t num_params) {
+    typedef std::unique_ptr<RS::RollingStatistics<D>> Ptr;
+    switch (statistic) {
+        case RS_MEAN: return Ptr(new RS::RollingMean<D>(skip_nan));
+        case RS_VARIANCE: return Ptr(new RS::RollingVariance<D>(skip_nan));
+        case RS_SKEWNESS: return Ptr(new RS::RollingSkewness<D>(skip_nan));
+        case RS_ZSCORE: return Ptr(new RS::RollingZScore<D>(skip_nan));
+        case RS_MAX: return Ptr(new RS::RollingMax<D>(skip_nan));
+        case RS_MIN: return Ptr(new RS::RollingMin<D>(skip_nan));
+        case RS_RANK: return Ptr(new RS::RollingRank<D>(skip_nan, param(params, num_params, 0, 0) != 0));
+        case RS_ORDER_STATISTICS: {
+            D order = static_cast<D>(required_param(params, num_params, 0, "order"));
+            return Ptr(new RS::RollingOrderStatistics<D>(order, skip_nan, param(params, num_params, 1, 0) != 0));
+        }
+        case RS_STREAK: return Ptr(new RS::RollingStreak<D>(static_cast<D>(param(params, num_params, 0, 0)), skip_nan));
+        case RS_MAX_STREAK: return Ptr(new RS::RollingMaxStreak<D>(static_cast<D>(param(params, num_params, 0, 0)), skip_nan));
+        case RS_COUNT_ABOVE: {
+            D threshold = static_cast<D>(required_param(params, num_params, 0, "threshold"));
+            return Ptr(new RS::RollingCountAbove<D>(threshold, skip_nan, param(params, num_params, 1, 0) != 0));
+        }
+        case RS_FRACTION_ABOVE: {
+            D threshold = static_cast<D>(required_param(params, num_params, 0, "threshold"));
+            return Ptr(new RS::RollingFractionAbove<D>(threshold, skip_nan, param(params, num_params, 1, 0) != 0));
+        }
+        case RS_ENTROPY: {
+            double num_bins = required_param(params, num_params, 0, "num_bins");
+            D lower = static_cast<D>(required_param(params, num_params, 1, "lower"));
+            D upper = static_cast<D>(required_param(params, num_params, 2, "upper"));
+            if (!(num_bins >= 1 && num_bins <= 1e9)) { throw std::invalid_argument("rs_create: num_bins must be in [1, 1e9]"); }
+            return Ptr(new RS::RollingEntropy<D>(static_cast<size_t>(num_bins), lower, upper, skip_nan, param(params, num_params, 3, 0) != 0));
+        }
+        default: throw std::invalid_argument("rs_create: unknown statistic " + std::to_string(statistic));
+    }
+}
+
+// the statistic of a handle for dtype D, or nullptr if the handle is of the other dtype.
+template <typename D> RS::RollingStatistics<D>* get(rs_handle* handle);
+template <> RS::RollingStatistics<float>* get<float>(rs_handle* handle) { return handle->f32.get(); }
+template <> RS::RollingStatistics<double>* get<double>(rs_handle* handle) { return handle->f64.get(); }
+
+template <typename D>
+const char* dtype_name() { return sizeof(D) == sizeof(float) ? "float32" : "float64"; }
+
+template <typename D>
+int dtype_error(const char* function) {
+    return fail(RS_ERROR_DTYPE, std::string(function) + ": the handle is not " + dtype_name<D>());
+}
+
+template <typename D>
+inline void update(RS::RollingStatistics<D>& rs, D val, D& out, size_t window, size_t min_periods) {
+    /* one step of roll_lane(), except that a window longer than 'window' is popped down to it. */
+    rs.push(val);
+    while (rs.size() > window) { rs.pop(); }
+    out = rs.size_notnan() >= min_periods ? rs.compute() : static_cast<D>(NAN);
+}
+
+template <typename D>
+int push(rs_handle* handle, D val, const char* function) {
+    if (handle == nullptr) { return fail(RS_ERROR_INVALID_ARGUMENT, std::string(function) + ": handle is NULL"); }
+    RS::RollingStatistics<D>* rs = get<D>(handle);
+    if (rs == nullptr) { return dtype_error<D>(function); }
+    return guarded([&]() { rs->push(val); return static_cast<int>(RS_OK); });
+}
+
+template <typename D>
+D compute(rs_handle* handle, const char* function) {
+    if (handle == nullptr) { fail(RS_ERROR_INVALID_ARGUMENT, std::string(function) + ": handle is NULL"); return NAN; }
+    RS::RollingStatistics<D>* rs = get<D>(handle);
+    if (rs == nullptr) { dtype_error<D>(function); return NAN; }
+    D val = NAN;
+    guarded([&]() { val = rs->compute(); return static_cast<int>(RS_OK); });
+    return val;
+}
+
+template <typename D>
+int roll(rs_handle* handle, const D* in, D* out, size_t n, size_t window, size_t min_periods, const char* function) {
+    if (handle == nullptr || (n > 0 && (in == nullptr || out == nullptr)) || window == 0) {
+        return fail(RS_ERROR_INVALID_ARGUMENT, std::string(function) + ": need a handle, in, out and window > 0");
+    }
+    RS::RollingStatistics<D>* rs = get<D>(handle);
+    if (rs == nullptr) { return dtype_error<D>(function); }
+    return guarded([&]() {
+        for (size_t i = 0; i != n; ++i) { update(*rs, in[i], out[i], window, min_periods); }
+        return static_cast<int>(RS_OK);
+    });
+}
+
+template <typename D>
+int update_many(rs_handle* const* handles, size_t num_handles, const D* vals, D* out, size_t window, size_t min_periods, const char* function) {
+    /* checks every handle first, so that the streams are advanced all or none. */
+    if ((num_handles > 0 && (handles == nullptr || vals == nullptr || out == nullptr)) || window == 0) {
+        return fail(RS_ERROR_INVALID_ARGUMENT, std::string(function) + ": need handles, vals, out and window > 0");
+    }
+    for (size_t i = 0; i != num_handles; ++i) {
+        if (handles[i] == nullptr) { return fail(RS_ERROR_INVALID_ARGUMENT, std::string(function) + ": handle " + std::to_string(i) + " is NULL"); }
+        if (get<D>(handles[i]) == nullptr) { return dtype_error<D>(function); }
+    }
+    return guarded([&]() {
+        for (size_t i = 0; i != num_handles; ++i) { update(*get<D>(handles[i]), vals[i], out[i], window, min_periods); }
+        return static_cast<int>(RS_OK);
+    });
+}
+
+template <typename D>
+int roll_ndarray(rs_handle* handle, D* arr, size_t ndim, const size_t* shape, const size_t* strides, size_t axis, size_t window, size_t min_periods, size_t num_threads, const char* function) {
+    if (handle == nullptr || arr == nullptr || shape == nullptr || ndim == 0 || axis >= ndim || window == 0) {
+        return fail(RS_ERROR_INVALID_ARGUMENT, std::string(function) + ": need a handle, arr, shape, axis < ndim and window > 0");
+    }
+    RS::RollingStatistics<D>* rs = get<D>(handle);
+    if (rs == nullptr) { return dtype_error<D>(function); }
+    return guarded([&]() {
+        std::vector<size_t> shape_(shape, shape + ndim);
+        std::vector<size_t> strides_;
+        if (strides != nullptr) { strides_.assign(strides, strides + ndim); }
+        rs->roll_ndarray(arr, shape_, axis, window, min_periods, strides_, num_threads);
+        return static_cast<int>(RS_OK);
+    });
+}
+
+}  // namespace
+
+
+extern "C" {
+
+int rs_abi_version(void) { return RS_C_ABI_VERSION; }
+
+const char* rs_last_error(void) { return last_error.c_str(); }
+
+rs_handle* rs_create(int statistic, int dtype, int skip_nan, const double* params, size_t num_params) {
+    std::unique_ptr<rs_handle> handle(new (std::nothrow) rs_handle());
+    if (!handle) { fail(RS_ERROR_RUNTIME, "rs_create: out of memory"); return nullptr; }
+    if (params == nullptr) { num_params = 0; }
+    int status = guarded([&]() {
+        handle->dtype = dtype;
+        if (dtype == RS_FLOAT32) { handle->f32 = make_statistic<float>(statistic, skip_nan != 0, params, num_params); }
+        else if (dtype == RS_FLOAT64) { handle->f64 = make_statistic<double>(statistic, skip_nan != 0, params, num_params); }
+        else { return fail(RS_ERROR_INVALID_ARGUMENT, "rs_create: dtype must be RS_FLOAT32 or RS_FLOAT64"); }
+        return static_cast<int>(RS_OK);
+    });
+    return status == RS_OK ? handle.release() : nullptr;
+}
+
+rs_handle* rs_clone(const rs_handle* handle) {
+    if (handle == nullptr) { fail(RS_ERROR_INVALID_ARGUMENT, "rs_clone: handle is NULL"); return nullptr; }
+    std::unique_ptr<rs_handle> copy(new (std::nothrow) rs_handle());
+    if (!copy) { fail(RS_ERROR_RUNTIME, "rs_clone: out of memory"); return nullptr; }
+    int status = guarded([&]() {
+        copy->dtype = handle->dtype;
+        if (handle->f32) { copy->f32 = handle->f32->clone(); }
+        if (handle->f64) { copy->f64 = handle->f64->clone(); }
+        return static_cast<int>(RS_OK);
+    });
+    return status == RS_OK ? copy.release() : nullptr;
+}
+
+void rs_destroy(rs_handle* handle) { delete handle; }
+
+int rs_dtype_of(const rs_handle* handle) {
+    if (handle == nullptr) { return fail(RS_ERROR_INVALID_ARGUMENT, "rs_dtype_of: handle is NULL"); }
+    return handle->dtype;
+}
+
+int rs_clear(rs_handle* handle) {
+    if (handle == nullptr) { return fail(RS_ERROR_INVALID_ARGUMENT, "rs_clear: handle is NULL"); }
+    return guarded([&]() {
+        if (handle->f32) { handle->f32->clear(); }
+        if (handle->f64) { handle->f64->clear(); }
+        return static_cast<int>(RS_OK);
+    });
+}
+
+size_t rs_size(const rs_handle* handle) {
+    if (handle == nullptr) { return 0; }
+    return handle->f32 ? handle->f32->size() : handle->f64->size();
+}
+
+size_t rs_size_nan(const rs_handle* handle) {
+    if (handle == nullptr) { return 0; }
+    return handle->f32 ? handle->f32->size_nan() : handle->f64->size_nan();
+}
+
+size_t rs_size_notnan(const rs_handle* handle) {
+    if (handle == nullptr) { return 0; }
+    return handle->f32 ? handle->f32->size_notnan() : handle->f64->size_notnan();
+}
+
+int rs_push_f32(rs_handle* handle, float val) { return push<float>(handle, val, "rs_push_f32"); }
+int rs_push_f64(rs_handle* handle, double val) { return push<double>(handle, val, "rs_push_f64"); }
+
+int rs_pop(rs_handle* handle) {
+    if (handle == nullptr) { return fail(RS_ERROR_INVALID_ARGUMENT, "rs_pop: handle is NULL"); }
+    if (rs_size(handle) == 0) { return fail(RS_ERROR_EMPTY, "rs_pop: the window is empty"); }
+    return guarded([&]() {
+        if (handle->f32) { handle->f32->pop(); }
+        else { handle->f64->pop(); }
+        return static_cast<int>(RS_OK);
+    });
+}
+
+float rs_compute_f32(rs_handle* handle) { return compute<float>(handle, "rs_compute_f32"); }
+double rs_compute_f64(rs_handle* handle) { return compute<double>(handle, "rs_compute_f64"); }
+
+int rs_roll_f32(rs_handle* handle, const float* in, float* out, size_t n, size_t window, size_t min_periods) {
+    return roll<float>(handle, in, out, n, window, min_periods, "rs_roll_f32");
+}
+int rs_roll_f64(rs_handle* handle, const double* in, double* out, size_t n, size_t window, size_t min_periods) {
+    return roll<double>(handle, in, out, n, window, min_periods, "rs_roll_f64");
+}
+
+int rs_update_many_f32(rs_handle* const* handles, size_t num_handles, const float* vals, float* out, size_t window, size_t min_periods) {
+    return update_many<float>(handles, num_handles, vals, out, window, min_periods, "rs_update_many_f32");
+}
+int rs_update_many_f64(rs_handle* const* handles, size_t num_handles, const double* vals, double* out, size_t window, size_t min_periods) {
+    return update_many<double>(handles, num_handles, vals, out, window, min_periods, "rs_update_many_f64");
+}
+
+int rs_roll_ndarray_f32(rs_handle* handle, float* arr, size_t ndim, const size_t* shape, const size_t* strides, size_t axis, size_t window, size_t min_periods, size_t num_threads) {
+    return roll_ndarray<float>(handle, arr, ndim, shape, strides, axis, window, min_periods, num_threads, "rs_roll_ndarray_f32");
+}
+int rs_roll_ndarray_f64(rs_handle* handle, double* arr, size_t ndim, const size_t* shape, const size_t* strides, size_t axis, size_t window, size_t min_periods, size_t num_threads) {
+    return roll_ndarray<double>(handle, arr, ndim, shape, strides, axis, window, min_periods, num_threads, "rs_roll_ndarray_f64");
+}
+
+}  // extern "C"
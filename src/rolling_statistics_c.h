@@ -0,0 +1,114 @@
+#ifndef ROLLING_STATISTICS_C_H
+#define ROLLING_STATISTICS_C_H
+
+/**
+ * @file rolling_statistics_c.h
+ * @brief A C ABI for the rolling statistics, for FFIs (ctypes, cffi, Numba, Cython, Julia, ...) that cannot call C++.
+ */
+
+/*
+ * objects are opaque handles, created for one statistic and one dtype. functions with a _f32/_f64 suffix take and
+ * return values of that dtype, and fail with RS_ERROR_DTYPE on a handle of the other one. nothing throws across
+ * the ABI: functions return an RS_OK/RS_ERROR_* status, compute returns NaN and create returns NULL on failure,
+ * and rs_last_error() describes the last failure of the calling thread.
+ * a handle may be used by one thread at a time, different handles by different threads.
+ * the ABI is versioned by RS_C_ABI_VERSION: existing functions and enum values never change within a version.
+ * */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(RS_C_BUILDING)
+#define RS_C_API __declspec(dllexport)
+#else
+#define RS_C_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define RS_C_API __attribute__((visibility("default")))
+#else
+#define RS_C_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RS_C_ABI_VERSION 1
+
+typedef struct rs_handle rs_handle;
+
+enum rs_status{
+    RS_OK = 0,
+    RS_ERROR_INVALID_ARGUMENT = -1,  /* bad parameters, shape, axis or window */
+    RS_ERROR_DTYPE = -2,  /* the function is for the other dtype than the handle */
+    RS_ERROR_EMPTY = -3,  /* pop on an empty window */
+    RS_ERROR_RUNTIME = -4  /* e.g. out of memory */
+};
+
+enum rs_dtype{
+    RS_FLOAT32 = 0,
+    RS_FLOAT64 = 1
+};
+
+/*
+ * the statistics, with their parameters in rs_create's params, in this order. trailing parameters in brackets
+ * are optional, flags are 0 or 1.
+ * */
+enum rs_statistic{
+    RS_MEAN = 0,
+    RS_VARIANCE = 1,
+    RS_SKEWNESS = 2,
+    RS_ZSCORE = 3,
+    RS_MAX = 4,
+    RS_MIN = 5,
+    RS_RANK = 6,  /* [normalize] */
+    RS_ORDER_STATISTICS = 7,  /* order, [normalize] */
+    RS_STREAK = 8,  /* [threshold] */
+    RS_MAX_STREAK = 9,  /* [threshold] */
+    RS_COUNT_ABOVE = 10,  /* threshold, [dynamic] */
+    RS_FRACTION_ABOVE = 11,  /* threshold, [dynamic] */
+    RS_ENTROPY = 12  /* num_bins, lower, upper, [normalize] */
+};
+
+RS_C_API int rs_abi_version(void);
+RS_C_API const char* rs_last_error(void);
+
+RS_C_API rs_handle* rs_create(int statistic, int dtype, int skip_nan, const double* params, size_t num_params);
+RS_C_API rs_handle* rs_clone(const rs_handle* handle);
+RS_C_API void rs_destroy(rs_handle* handle);  /* NULL is ignored */
+RS_C_API int rs_dtype_of(const rs_handle* handle);
+RS_C_API int rs_clear(rs_handle* handle);
+RS_C_API size_t rs_size(const rs_handle* handle);
+RS_C_API size_t rs_size_nan(const rs_handle* handle);
+RS_C_API size_t rs_size_notnan(const rs_handle* handle);
+
+/* streaming, one value at a time. */
+RS_C_API int rs_push_f32(rs_handle* handle, float val);
+RS_C_API int rs_push_f64(rs_handle* handle, double val);
+RS_C_API int rs_pop(rs_handle* handle);
+RS_C_API float rs_compute_f32(rs_handle* handle);
+RS_C_API double rs_compute_f64(rs_handle* handle);
+
+/*
+ * batches. rs_roll continues the stream of handle with n values: push in[i], pop while the window is longer than
+ * 'window', and out[i] = compute(), or NaN with fewer than min_periods non-NaN values. in and out may be the same.
+ * rs_update_many advances num_handles streams by one value each the same way, vals[i] and out[i] for handles[i],
+ * e.g. one tick for many instruments.
+ * */
+RS_C_API int rs_roll_f32(rs_handle* handle, const float* in, float* out, size_t n, size_t window, size_t min_periods);
+RS_C_API int rs_roll_f64(rs_handle* handle, const double* in, double* out, size_t n, size_t window, size_t min_periods);
+RS_C_API int rs_update_many_f32(rs_handle* const* handles, size_t num_handles, const float* vals, float* out, size_t window, size_t min_periods);
+RS_C_API int rs_update_many_f64(rs_handle* const* handles, size_t num_handles, const double* vals, double* out, size_t window, size_t min_periods);
+
+/*
+ * roll_ndarray(): rolls arr inplace along axis, with strides in elements (NULL for C order). the handle gives the
+ * statistic and its parameters. its window is cleared first and is empty on return, whatever it held before.
+ * */
+RS_C_API int rs_roll_ndarray_f32(rs_handle* handle, float* arr, size_t ndim, const size_t* shape, const size_t* strides, size_t axis, size_t window, size_t min_periods, size_t num_threads);
+RS_C_API int rs_roll_ndarray_f64(rs_handle* handle, double* arr, size_t ndim, const size_t* shape, const size_t* strides, size_t axis, size_t window, size_t min_periods, size_t num_threads);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif
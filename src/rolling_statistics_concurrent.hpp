@@ -0,0 +1,618 @@
+#ifndef ROLLING_STATISTICS_CONCURRENT_HPP
+#define ROLLING_STATISTICS_CONCURRENT_HPP
+
+/**
+ * @file rolling_statistics_concurrent.hpp
+ * @author Zehua Yu (zehua.yu@columbia.edu)
+ * @copyright Copyright (c) 2022 Zehua Yu. Licensed under the MIT license.
+ * @brief Lock-free publication of rolling statistics to other threads and processes.
+ */
+
+/*  The classes in rolling_statistics.hpp are not thread-safe. Instead of locking them, the thread that owns an
+ *  accumulator publishes its results into a SeqlockSnapshot, which any number of readers can load without locks:
+ *
+ *      writer thread:  push()/pop() -> publish(rs)  -> SeqlockSnapshot  <- load()  reader threads
+ *                      (ConcurrentRollingStatistics bundles the accumulator with its snapshot)
+ *      feed threads:   ShardedEngine::push(producer, key, val) -> SpscRing -> worker threads -> snapshots <- load(key)
+ *      writer process: ShmPublisher::publish(slot, rs) -> POSIX shared memory <- ShmReader::load(slot)  other processes
+ * */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "rolling_statistics.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RS_HAS_POSIX_SHM
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace RS{
+
+const size_t SEQLOCK_SPINS = 64;  // attempts of SeqlockSnapshot::load() before it yields between them
+const size_t SEQLOCK_MAX_ATTEMPTS = size_t(1) << 20;  // before ShmReader::load() gives up, about a second of yields
+
+
+template <typename D>
+struct Snapshot{
+    /* the latest published results of one accumulator. */
+    D value = NAN;  // compute()
+    uint64_t size_nan = 0;
+    uint64_t size_notnan = 0;
+    uint64_t version = 0;  // number of publications so far, 0 if never published.
+};
+
+
+template <typename D>
+class SeqlockSnapshot{
+    /*
+     * single writer, many readers. the writer never waits, readers retry if a write overlapped their read.
+     * seq is odd while a write is in progress. all fields are atomics accessed with relaxed order, which are
+     * plain loads and stores on common hardware but keep concurrent access well defined; the fences order them.
+     * the object holds no pointers and occupies one cache line, so it can be placed in shared memory.
+     * */
+protected:
+    std::atomic<uint64_t> seq;
+    std::atomic<D> value;
+    std::atomic<uint64_t> num_vals_nan;
+    std::atomic<uint64_t> num_vals_notnan;
+    char padding[CACHE_LINE_SIZE - 3 * sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<D>)];  // avoid false sharing
+public:
+    SeqlockSnapshot(): seq(0), value(NAN), num_vals_nan(0), num_vals_notnan(0) {}
+    SeqlockSnapshot(const SeqlockSnapshot&) = delete;
+    SeqlockSnapshot& operator=(const SeqlockSnapshot&) = delete;
+    bool is_lock_free() const {
+        return seq.is_lock_free() && value.is_lock_free() && num_vals_nan.is_lock_free();
+    }
+    void store(D value_, uint64_t num_vals_nan_, uint64_t num_vals_notnan_) {
+        /* must only be called by one thread at a time. */
+        uint64_t s = seq.load(std::memory_order_relaxed) & ~uint64_t(1);  // also if a previous writer died mid-write
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value.store(value_, std::memory_order_relaxed);
+        num_vals_nan.store(num_vals_nan_, std::memory_order_relaxed);
+        num_vals_notnan.store(num_vals_notnan_, std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+    void publish(RollingStatistics<D>& rs) {
+        store(rs.compute(), rs.size_nan(), rs.size_notnan());
+    }
+    bool try_load(Snapshot<D>& snapshot) const {
+        /* a single attempt, fails if a write is in progress or overlapped. */
+        uint64_t s0 = seq.load(std::memory_order_acquire);
+        if (s0 & 1) { return false; }
+        snapshot.value = value.load(std::memory_order_relaxed);
+        snapshot.size_nan = num_vals_nan.load(std::memory_order_relaxed);
+        snapshot.size_notnan = num_vals_notnan.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t s1 = seq.load(std::memory_order_relaxed);
+        snapshot.version = s0 / 2;
+        return s0 == s1;
+    }
+    Snapshot<D> load() const {
+        /*
+         * retries until it gets a consistent snapshot, a write only takes a few stores. spins first, then yields,
+         * so a writer thread descheduled in the middle of a write only delays the readers.
+         * */
+        Snapshot<D> snapshot;
+        for (size_t attempt = 0; !try_load(snapshot); ++attempt) {
+            if (attempt >= SEQLOCK_SPINS) { std::this_thread::yield(); }
+        }
+        return snapshot;
+    }
+    Snapshot<D> load(size_t max_attempts) const {
+        /*
+         * as load(), but throws std::runtime_error after max_attempts. for writers that can die in the middle of a
+         * write, i.e. other processes.
+         * */
+        Snapshot<D> snapshot;
+        for (size_t attempt = 0; !try_load(snapshot); ++attempt) {
+            if (attempt + 1 >= max_attempts) {
+                throw std::runtime_error("RS::SeqlockSnapshot: no consistent snapshot, the writer may have died during a write");
+            }
+            if (attempt >= SEQLOCK_SPINS) { std::this_thread::yield(); }
+        }
+        return snapshot;
+    }
+};
+
+
+template <typename D, class Class>
+class ConcurrentRollingStatistics{
+    /*
+     * wraps an accumulator for one writer thread and any number of reader threads, replacing a mutex around it.
+     * the writer calls push()/pop()/clear()/update(), each of which republishes compute() into a SeqlockSnapshot.
+     * readers call compute()/size()/load(), which never lock and never touch the accumulator itself.
+     * */
+protected:
+    Class rs;
+    SeqlockSnapshot<D> snapshot;
+public:
+    template <typename... Args>
+    explicit ConcurrentRollingStatistics(Args&&... args): rs(std::forward<Args>(args)...) { publish(); }
+    ConcurrentRollingStatistics(const ConcurrentRollingStatistics&) = delete;
+    ConcurrentRollingStatistics& operator=(const ConcurrentRollingStatistics&) = delete;
+
+    // writer side
+    inline Class& writer() { return rs; }  // direct access, call publish() after modifying it.
+    inline void publish() { snapshot.publish(rs); }
+    void clear() {
+        rs.clear();
+        publish();
+    }
+    void push(const D& val) {
+        rs.push(val);
+        publish();
+    }
+    void pop() {
+        rs.pop();
+        publish();
+    }
+    void update(const D* vals, size_t n, size_t window) {
+        /* push a batch of values, keeping at most window of them, and publish once at the end. */
+        for (size_t i = 0; i != n; ++i) {
+            rs.push(vals[i]);
+            if (rs.size() > window) { rs.pop(); }
+        }
+        publish();
+    }
+
+    // reader side, safe from any thread
+    inline Snapshot<D> load() const { return snapshot.load(); }
+    inline D compute() const { return snapshot.load().value; }
+    inline size_t size() const {
+        Snapshot<D> snapshot_ = snapshot.load();
+        return static_cast<size_t>(snapshot_.size_nan + snapshot_.size_notnan);
+    }
+    inline size_t size_nan() const { return static_cast<size_t>(snapshot.load().size_nan); }
+    inline size_t size_notnan() const { return static_cast<size_t>(snapshot.load().size_notnan); }
+    MemoryUsage memory_usage() const {
+        /* writer side, like writer(). */
+        MemoryUsage usage;
+        add_contained_memory_usage(usage, rs);
+        usage.object_bytes = sizeof(*this);
+        return usage;
+    }
+};
+
+
+template <typename T>
+class SpscRing{
+    /*
+     * bounded lock-free queue for exactly one producer thread and one consumer thread.
+     * capacity is rounded up to a power of two. each side caches the other side's index,
+     * so the shared cache lines are only read when the ring looks full or empty.
+     * */
+protected:
+    std::vector<T> buf;
+    size_t mask;
+    std::atomic<size_t> head;  // next slot to read, written by the consumer
+    char padding_head[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;  // next slot to write, written by the producer
+    char padding_tail[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    size_t cached_head = 0;  // producer's copy
+    char padding_cached_head[CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t cached_tail = 0;  // consumer's copy
+public:
+    explicit SpscRing(size_t capacity_): head(0), tail(0) {
+        size_t capacity = 1;
+        while (capacity < capacity_) { capacity <<= 1; }
+        buf.resize(capacity);
+        mask = capacity - 1;
+    }
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    inline size_t capacity() const { return buf.size(); }
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, buf);
+        return usage;
+    }
+    inline size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    bool try_push(const T& item) {
+        /* producer only. returns false if the ring is full. */
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == buf.size()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == buf.size()) { return false; }
+        }
+        buf[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    size_t pop_batch(T* out, size_t max_items) {
+        /* consumer only. moves up to max_items into out and returns how many. */
+        size_t h = head.load(std::memory_order_relaxed);
+        if (cached_tail == h) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (cached_tail == h) { return 0; }
+        }
+        size_t n = std::min(max_items, cached_tail - h);
+        for (size_t i = 0; i != n; ++i) {
+            out[i] = buf[(h + i) & mask];
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+};
+
+
+template <typename D>
+struct KeyedValue{
+    uint64_t key;
+    D value;
+};
+
+
+const size_t ENGINE_IDLE_SPINS = 64;  // empty rounds of a ShardedEngine worker before it yields between them
+const size_t ENGINE_IDLE_YIELDS = 64;  // and before it sleeps, starting at 1 microsecond
+const size_t ENGINE_IDLE_MAX_SLEEP_US = 200;  // doubling up to this, the latency of a worker that has been idle
+
+
+template <typename D, class Class>
+class ShardedEngine{
+    /*
+     * keyed ingestion for many symbols fed by several threads. keys are dense ids in [0, num_keys), and key k is
+     * owned by worker k % num_workers, which is the only thread ever touching its accumulator, so push()/pop()
+     * need no locks. each producer gets its own SpscRing into each worker, so producers never contend either.
+     * a worker drains its rings in batches of up to batch_size, keeps at most window values per key, and
+     * republishes every key it touched once per batch. query() reads those snapshots from any thread.
+     *
+     *     producer p --push(p, key, val)--> rings[p] of worker (key % num_workers) --drain--> accumulators --> snapshots
+     * */
+protected:
+    struct Worker{
+        std::vector<Class> accumulators;  // key k at index k / num_workers
+        std::vector<SeqlockSnapshot<D>> snapshots;
+        std::vector<std::unique_ptr<SpscRing<KeyedValue<D>>>> rings;  // one per producer
+        std::thread thread;
+        Worker(size_t num_keys_, size_t num_producers_, size_t ring_capacity_, const Class& prototype):
+            accumulators(num_keys_, prototype), snapshots(num_keys_) {
+            for (size_t p = 0; p != num_producers_; ++p) {
+                rings.push_back(std::unique_ptr<SpscRing<KeyedValue<D>>>(new SpscRing<KeyedValue<D>>(ring_capacity_)));
+            }
+        }
+    };
+    size_t num_keys;
+    size_t window;
+    size_t batch_size;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping;
+
+    void drain_loop(Worker& worker) {
+        std::vector<KeyedValue<D>> batch(batch_size);
+        std::vector<size_t> touched;
+        std::vector<bool> is_touched(worker.accumulators.size(), false);
+        size_t num_workers = workers.size();
+        size_t num_idle = 0;  // consecutive empty rounds
+        size_t sleep_us = 1;
+        while (true) {
+            bool stop_requested = stopping.load(std::memory_order_acquire);  // read before draining, see below
+            size_t num_drained = 0;
+            for (size_t p = 0; p != worker.rings.size(); ++p) {
+                size_t n = worker.rings[p]->pop_batch(batch.data(), batch_size);
+                num_drained += n;
+                for (size_t i = 0; i != n; ++i) {
+                    size_t index = static_cast<size_t>(batch[i].key / num_workers);
+                    Class& rs = worker.accumulators[index];
+                    rs.push(batch[i].value);
+                    if (rs.size() > window) { rs.pop(); }
+                    if (!is_touched[index]) {
+                        is_touched[index] = true;
+                        touched.push_back(index);
+                    }
+                }
+            }
+            for (size_t i = 0; i != touched.size(); ++i) {
+                worker.snapshots[touched[i]].publish(worker.accumulators[touched[i]]);
+                is_touched[touched[i]] = false;
+            }
+            touched.clear();
+            if (num_drained == 0) {
+                // everything pushed before stop() was requested has been applied by now.
+                if (stop_requested) { break; }
+                // back off: spin, then yield, then sleep, so that idle workers do not hold their cores.
+                ++num_idle;
+                if (num_idle <= ENGINE_IDLE_SPINS) { continue; }
+                if (num_idle <= ENGINE_IDLE_SPINS + ENGINE_IDLE_YIELDS) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+                sleep_us = std::min<size_t>(2 * sleep_us, ENGINE_IDLE_MAX_SLEEP_US);
+            }
+            else {
+                num_idle = 0;
+                sleep_us = 1;
+            }
+        }
+    }
+    inline Worker& owner(uint64_t key) const { return *workers[static_cast<size_t>(key % workers.size())]; }
+    inline size_t local_index(uint64_t key) const { return static_cast<size_t>(key / workers.size()); }
+
+public:
+    template <typename... Args>
+    ShardedEngine(size_t num_keys_, size_t window_, size_t num_workers_, size_t num_producers_,
+                  size_t ring_capacity_, size_t batch_size_, Args&&... args):
+        num_keys(num_keys_), window(window_), batch_size(batch_size_), stopping(false) {
+        /* args are forwarded to the constructor of every accumulator. workers start immediately. */
+        assert(num_workers_ > 0 && batch_size_ > 0);
+        Class prototype(std::forward<Args>(args)...);
+        for (size_t w = 0; w != num_workers_; ++w) {
+            size_t num_local_keys = num_keys_ / num_workers_ + (w < num_keys_ % num_workers_ ? 1 : 0);
+            workers.push_back(std::unique_ptr<Worker>(new Worker(num_local_keys, num_producers_, ring_capacity_, prototype)));
+        }
+        try {
+            for (size_t w = 0; w != num_workers_; ++w) {
+                Worker& worker = *workers[w];
+                worker.thread = std::thread([this, &worker]() { drain_loop(worker); });
+            }
+        } catch (...) {
+            stop();  // the destructor does not run, so join the workers already started
+            throw;
+        }
+    }
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+    ~ShardedEngine() { stop(); }
+
+    inline size_t size() const { return num_keys; }
+    inline size_t num_workers() const { return workers.size(); }
+    inline size_t num_producers() const { return workers[0]->rings.size(); }
+
+    bool try_push(size_t producer, uint64_t key, const D& val) {
+        /* only ever call with the same producer id from the same thread. false if the ring is full. */
+        assert(producer < num_producers() && key < num_keys);
+        KeyedValue<D> item;
+        item.key = key;
+        item.value = val;
+        return owner(key).rings[producer]->try_push(item);
+    }
+    void push(size_t producer, uint64_t key, const D& val) {
+        /* as try_push(), but waits for the worker to make room. */
+        while (!try_push(producer, key, val)) { std::this_thread::yield(); }
+    }
+    void stop() {
+        /* applies everything pushed so far and joins the workers. producers must have stopped pushing. */
+        stopping.store(true, std::memory_order_release);
+        for (size_t w = 0; w != workers.size(); ++w) {
+            if (workers[w]->thread.joinable()) { workers[w]->thread.join(); }
+        }
+    }
+
+    // query path, safe from any thread
+    inline Snapshot<D> load(uint64_t key) const {
+        assert(key < num_keys);
+        return owner(key).snapshots[local_index(key)].load();
+    }
+    inline D compute(uint64_t key) const { return load(key).value; }
+    Class& accumulator(uint64_t key) {
+        /* direct access, only safe after stop(). */
+        assert(key < num_keys);
+        return owner(key).accumulators[local_index(key)];
+    }
+    MemoryUsage memory_usage() const {
+        /*
+         * the engine, its workers and every accumulator, snapshot and ring. accumulators and snapshots stored in
+         * vectors count as objects. like accumulator(), only safe after stop().
+         * */
+        MemoryUsage usage;
+        usage.object_bytes = sizeof(*this);
+        add_memory_usage(usage, workers);
+        for (size_t w = 0; w != workers.size(); ++w) {
+            const Worker& worker = *workers[w];
+            MemoryUsage containers;
+            add_memory_usage(containers, worker.accumulators);
+            add_memory_usage(containers, worker.snapshots);
+            add_memory_usage(containers, worker.rings);
+            usage.object_bytes += sizeof(Worker) + containers.buffer_bytes;
+            usage.overhead_bytes += MALLOC_OVERHEAD + containers.overhead_bytes;
+            for (size_t i = 0; i != worker.accumulators.size(); ++i) {
+                add_contained_memory_usage(usage, worker.accumulators[i]);
+            }
+            for (size_t p = 0; p != worker.rings.size(); ++p) {
+                usage.merge(worker.rings[p]->memory_usage());
+                usage.overhead_bytes += MALLOC_OVERHEAD;
+            }
+        }
+        return usage;
+    }
+};
+
+
+#ifdef RS_HAS_POSIX_SHM
+
+const uint32_t SHM_MAGIC = 0x4d485352;  // "RSHM"
+const uint16_t SHM_VERSION = 1;
+
+struct ShmHeader{
+    /* first cache line of the segment, followed by num_slots of SeqlockSnapshot<D>. */
+    uint32_t magic;
+    uint16_t version;
+    uint8_t value_size;  // sizeof(value_type)
+    uint8_t reserved;
+    uint64_t num_slots;
+    char padding[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+};
+
+
+template <typename D>
+class ShmSegment{
+    /* a mapped POSIX shared memory segment holding a ShmHeader and an array of SeqlockSnapshot<D>. */
+protected:
+    std::string shm_name;
+    void* ptr = nullptr;
+    size_t num_bytes = 0;
+    static size_t bytes_needed(size_t num_slots_) {
+        return sizeof(ShmHeader) + num_slots_ * sizeof(SeqlockSnapshot<D>);
+    }
+    static std::runtime_error error(const std::string& what, const std::string& name_) {
+        return std::runtime_error("RS::" + what + " '" + name_ + "': " + std::strerror(errno));
+    }
+    const ShmHeader& header() const { return *static_cast<const ShmHeader*>(ptr); }
+    SeqlockSnapshot<D>* slots() const {
+        return reinterpret_cast<SeqlockSnapshot<D>*>(static_cast<char*>(ptr) + sizeof(ShmHeader));
+    }
+    ShmSegment(const std::string& name_): shm_name(name_) {}
+public:
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+    ~ShmSegment() {
+        if (ptr != nullptr) { munmap(ptr, num_bytes); }
+    }
+    inline const std::string& name() const { return shm_name; }
+    inline size_t num_slots() const { return static_cast<size_t>(header().num_slots); }
+};
+
+
+template <typename D>
+class ShmPublisher : public ShmSegment<D>{
+    /*
+     * creates a segment named name_ (e.g. "/features") with num_slots_ slots, then publishes the latest results of
+     * accumulators into them. one writer per slot. the segment outlives the process until unlink() is called.
+     * a published segment of the same layout, e.g. of a restarted publisher, is taken over as it is, so its readers
+     * keep their mapping and see the last values until republished. one of another layout is never resized under
+     * its readers, unlink() it first.
+     * */
+protected:
+    bool attach(int fd, size_t num_slots_) {
+        /* maps an already published segment. false if there is none, throws if it has another layout. */
+        struct stat st;
+        if (fstat(fd, &st) != 0) { throw this->error("ShmPublisher: cannot stat", this->shm_name); }
+        if (static_cast<size_t>(st.st_size) < sizeof(ShmHeader)) { return false; }
+        this->num_bytes = static_cast<size_t>(st.st_size);
+        this->ptr = mmap(nullptr, this->num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (this->ptr == MAP_FAILED) {
+            this->ptr = nullptr;
+            throw this->error("ShmPublisher: cannot map", this->shm_name);
+        }
+        const ShmHeader& header_ = this->header();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_.magic != SHM_MAGIC) {  // never completed, so no reader has mapped it
+            munmap(this->ptr, this->num_bytes);
+            this->ptr = nullptr;
+            return false;
+        }
+        if (header_.version != SHM_VERSION || header_.value_size != sizeof(D) || header_.num_slots != num_slots_
+            || this->bytes_needed(num_slots_) > this->num_bytes) {
+            throw std::runtime_error("RS::ShmPublisher: '" + this->shm_name + "' is published with another layout, unlink() it first");
+        }
+        return true;
+    }
+public:
+    ShmPublisher(const std::string& name_, size_t num_slots_): ShmSegment<D>(name_) {
+        int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) { throw this->error("ShmPublisher: cannot open", name_); }
+        try {
+            if (attach(fd, num_slots_)) {
+                close(fd);
+                return;
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        this->num_bytes = this->bytes_needed(num_slots_);
+        if (ftruncate(fd, static_cast<off_t>(this->num_bytes)) != 0) {
+            close(fd);
+            throw this->error("ShmPublisher: cannot resize", name_);
+        }
+        this->ptr = mmap(nullptr, this->num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (this->ptr == MAP_FAILED) {
+            this->ptr = nullptr;
+            throw this->error("ShmPublisher: cannot map", name_);
+        }
+        // construct the slots before the header, so readers never see a valid header over garbage.
+        ShmHeader* header_ = static_cast<ShmHeader*>(this->ptr);
+        header_->magic = 0;
+        for (size_t i = 0; i != num_slots_; ++i) {
+            new (this->slots() + i) SeqlockSnapshot<D>();
+        }
+        if (num_slots_ > 0 && !this->slots()[0].is_lock_free()) {
+            throw std::runtime_error("RS::ShmPublisher: atomics are not lock-free on this platform");
+        }
+        header_->version = SHM_VERSION;
+        header_->value_size = static_cast<uint8_t>(sizeof(D));
+        header_->num_slots = num_slots_;
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = SHM_MAGIC;
+    }
+    void store(size_t slot, D value_, uint64_t num_vals_nan_, uint64_t num_vals_notnan_) {
+        assert(slot < this->num_slots());
+        this->slots()[slot].store(value_, num_vals_nan_, num_vals_notnan_);
+    }
+    void publish(size_t slot, RollingStatistics<D>& rs) {
+        assert(slot < this->num_slots());
+        this->slots()[slot].publish(rs);
+    }
+    void unlink() {
+        /* removes the name, mapped readers keep working until they unmap. */
+        shm_unlink(this->shm_name.c_str());
+    }
+};
+
+
+template <typename D>
+class ShmReader : public ShmSegment<D>{
+    /* maps an existing segment read-only. load() is a few plain loads, no locks or syscalls. */
+public:
+    explicit ShmReader(const std::string& name_): ShmSegment<D>(name_) {
+        int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+        if (fd < 0) { throw this->error("ShmReader: cannot open", name_); }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw this->error("ShmReader: cannot stat", name_);
+        }
+        this->num_bytes = static_cast<size_t>(st.st_size);
+        if (this->num_bytes < sizeof(ShmHeader)) {
+            close(fd);
+            throw std::runtime_error("RS::ShmReader: '" + name_ + "' is not a published segment");
+        }
+        this->ptr = mmap(nullptr, this->num_bytes, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (this->ptr == MAP_FAILED) {
+            this->ptr = nullptr;
+            throw this->error("ShmReader: cannot map", name_);
+        }
+        const ShmHeader& header_ = this->header();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_.magic != SHM_MAGIC || header_.version != SHM_VERSION
+            || header_.value_size != sizeof(D) || this->bytes_needed(header_.num_slots) > this->num_bytes) {
+            throw std::runtime_error("RS::ShmReader: '" + name_ + "' is not a compatible published segment");
+        }
+    }
+    Snapshot<D> load(size_t slot) const {
+        /* throws std::runtime_error if the publisher died in the middle of writing this slot, see SeqlockSnapshot. */
+        assert(slot < this->num_slots());
+        return this->slots()[slot].load(SEQLOCK_MAX_ATTEMPTS);
+    }
+    bool try_load(size_t slot, Snapshot<D>& snapshot) const {
+        assert(slot < this->num_slots());
+        return this->slots()[slot].try_load(snapshot);
+    }
+};
+
+#endif  // RS_HAS_POSIX_SHM
+
+
+}  // namespace RS
+#endif
@@ -3,11 +3,36 @@
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include "rolling_statistics.hpp"
+#include "rolling_statistics_concurrent.hpp"
 namespace py = pybind11;
 
 
+template <typename T>
+py::array_t<T> checked_array(const py::array& arr, bool writeable){
+    /*
+     * arr itself, as an array_t<T>. pybind11 would otherwise cast an array of another dtype into a temporary copy,
+     * which doubles the memory, and roll_ndarray() would write its results into the copy and lose them.
+     * */
+    if (!py::array_t<T>::check_(arr)) {
+        std::string expected = py::str(py::dtype::of<T>());
+        throw py::type_error("expected an array of dtype " + expected + ", got " + std::string(py::str(arr.dtype())) +
+                             ". use a statistic of the array's dtype, or convert it with arr.astype('" + expected + "') and keep the result");
+    }
+    if (writeable && !arr.writeable()) {
+        throw py::value_error("the array is read-only, and results are written inplace");
+    }
+    return py::reinterpret_borrow<py::array_t<T>>(arr);
+}
+
+
+std::string type_name(const py::handle& obj){
+    return py::str(obj.get_type().attr("__name__"));
+}
+
+
 template <typename D>
-void roll_ndarray(py::array_t<D> arr, RS::RollingStatistics<D>& rs, size_t axis, size_t window, size_t min_periods){
+void roll_ndarray(const py::array& arr_any, RS::RollingStatistics<D>& rs, size_t axis, size_t window, size_t min_periods, size_t num_threads, bool deterministic){
+    py::array_t<D> arr = checked_array<D>(arr_any, true);
     py::buffer_info info_arr = arr.request();
     D* ptr_arr = static_cast<D*>(info_arr.ptr);
     std::vector<size_t> shape;
@@ -18,7 +43,172 @@ void roll_ndarray(py::array_t<D> arr, RS::RollingStatistics<D>& rs, size_t axis,
     for (py::ssize_t& s: info_arr.strides){
         strides.push_back(static_cast<size_t>(s / info_arr.itemsize));
     }
-    rs.roll_ndarray(ptr_arr, shape, axis, window, min_periods, strides);
+    py::gil_scoped_release release;  // the buffer stays alive with arr, other Python threads may run meanwhile
+    rs.roll_ndarray(ptr_arr, shape, axis, window, min_periods, strides, num_threads, deterministic);
+}
+
+
+template <typename T>
+py::array_t<double> roll_ndarray_bits(const py::array& arr_any, const RS::RollingBitStatistics<T>& rs, size_t axis, size_t window, size_t min_periods){
+    /* the signal is not overwritten, results go to a new C-contiguous float64 array. */
+    py::array_t<T> arr = checked_array<T>(arr_any, false);
+    py::buffer_info info_arr = arr.request();
+    const T* ptr_arr = static_cast<const T*>(info_arr.ptr);
+    std::vector<size_t> shape;
+    for (py::ssize_t& s: info_arr.shape){
+        shape.push_back(static_cast<size_t>(s));
+    }
+    std::vector<size_t> strides;
+    for (py::ssize_t& s: info_arr.strides){
+        strides.push_back(static_cast<size_t>(s / info_arr.itemsize));
+    }
+    py::array_t<double> out(info_arr.shape);
+    double* ptr_out = static_cast<double*>(out.request().ptr);
+    py::gil_scoped_release release;
+    rs.roll_ndarray(ptr_arr, ptr_out, shape, axis, window, min_periods, strides);
+    return out;
+}
+
+
+template <typename D>
+void first_touch(const py::array& arr_any, size_t num_threads){
+    py::array_t<D> arr = checked_array<D>(arr_any, true);
+    // the whole buffer is filled from its first element, which is only the array itself if it is contiguous.
+    if (!(arr.flags() & (py::array::c_style | py::array::f_style))) {
+        throw py::value_error("first_touch: the array must be contiguous");
+    }
+    py::buffer_info info_arr = arr.request();
+    D* ptr_arr = static_cast<D*>(info_arr.ptr);
+    size_t size_arr = 1;
+    for (py::ssize_t& s: info_arr.shape){
+        size_arr *= static_cast<size_t>(s);
+    }
+    py::gil_scoped_release release;
+    RS::first_touch(ptr_arr, size_arr, num_threads);
+}
+
+
+py::object roll_ndarray_any(const py::array& arr, const py::object& rs, size_t axis, size_t window, size_t min_periods, size_t num_threads, bool deterministic){
+    /* the dtype-generic roll_ndarray(): dispatches on the class of rs, and arr must have its dtype. */
+    if (py::isinstance<RS::RollingStatistics<float>>(rs)) {
+        roll_ndarray<float>(arr, rs.cast<RS::RollingStatistics<float>&>(), axis, window, min_periods, num_threads, deterministic);
+        return py::none();
+    }
+    if (py::isinstance<RS::RollingStatistics<double>>(rs)) {
+        roll_ndarray<double>(arr, rs.cast<RS::RollingStatistics<double>&>(), axis, window, min_periods, num_threads, deterministic);
+        return py::none();
+    }
+    bool is_bool = py::isinstance<RS::RollingBitStatistics<bool>>(rs);
+    if (is_bool || py::isinstance<RS::RollingBitStatistics<uint8_t>>(rs)) {
+        if (num_threads != 1 || deterministic) { throw py::value_error("roll_ndarray: the bit statistics roll on one thread"); }
+        if (is_bool) { return roll_ndarray_bits<bool>(arr, rs.cast<const RS::RollingBitStatistics<bool>&>(), axis, window, min_periods); }
+        return roll_ndarray_bits<uint8_t>(arr, rs.cast<const RS::RollingBitStatistics<uint8_t>&>(), axis, window, min_periods);
+    }
+    throw py::type_error("roll_ndarray: rs must be a rolling statistic, got " + type_name(rs));
+}
+
+
+void first_touch_any(const py::array& arr, size_t num_threads){
+    if (py::array_t<float>::check_(arr)) { first_touch<float>(arr, num_threads); }
+    else if (py::array_t<double>::check_(arr)) { first_touch<double>(arr, num_threads); }
+    else { throw py::type_error("first_touch: expected an array of dtype float32 or float64, got " + std::string(py::str(arr.dtype()))); }
+}
+
+
+std::string dtype_suffix(const py::object& dtype_like, bool bits){
+    /* the class suffix of a dtype: float/double, or bool/uint8 for the bit statistics. */
+    py::dtype dtype = py::dtype::from_args(dtype_like);
+    if (!bits && dtype.equal(py::dtype::of<float>())) { return "float"; }
+    if (!bits && dtype.equal(py::dtype::of<double>())) { return "double"; }
+    if (bits && dtype.equal(py::dtype::of<bool>())) { return "bool"; }
+    if (bits && dtype.equal(py::dtype::of<uint8_t>())) { return "uint8"; }
+    throw py::type_error("unsupported dtype " + std::string(py::str(dtype)) + (bits ? ", expected bool or uint8" : ", expected float32 or float64"));
+}
+
+
+void declare_dtype_factory(py::module& m, const std::string& name, const std::string& default_dtype, bool bits){
+    /* name(*args, dtype=default_dtype, **kwargs) constructs the class name_<suffix> of that dtype. */
+    std::string module_name = py::str(m.attr("__name__"));
+    std::string doc = "Constructs " + name + "_" + (bits ? "bool/_uint8" : "float/_double") + " for dtype (default " + default_dtype + "), with the other arguments of its constructor.";
+    m.def(name.c_str(), [module_name, name, default_dtype, bits](py::args args, py::kwargs kwargs) {
+        py::object dtype = py::str(default_dtype);
+        if (kwargs.contains("dtype")) { dtype = kwargs.attr("pop")("dtype"); }
+        return py::module::import(module_name.c_str()).attr((name + "_" + dtype_suffix(dtype, bits)).c_str())(*args, **kwargs);
+    }, doc.c_str());
+}
+
+
+template <typename D>
+py::dict instrumentation(const RS::RollingStatistics<D>& rs){
+    RS::InstrumentationStats stats = rs.instrumentation();
+    py::dict d;
+    d["enabled"] = RS::INSTRUMENTATION_ENABLED;
+    d["num_pushes"] = stats.num_pushes;
+    d["num_pops"] = stats.num_pops;
+    d["num_nans"] = stats.num_nans;
+    d["max_deque_length"] = stats.max_deque_length;
+    d["num_tree_ops"] = stats.num_tree_ops;
+    d["num_allocations"] = stats.num_allocations;
+    d["num_lanes"] = stats.num_lanes;
+    d["lane_nanoseconds"] = stats.lane_nanoseconds;
+    d["max_lane_nanoseconds"] = stats.max_lane_nanoseconds;
+    return d;
+}
+
+
+template <class Class>
+py::dict memory_usage(const Class& rs){
+    RS::MemoryUsage usage = rs.memory_usage();
+    py::dict d;
+    d["object_bytes"] = usage.object_bytes;
+    d["buffer_bytes"] = usage.buffer_bytes;
+    d["num_nodes"] = usage.num_nodes;
+    d["node_bytes"] = usage.node_bytes;
+    d["overhead_bytes"] = usage.overhead_bytes;
+    d["total_bytes"] = usage.total();
+    return d;
+}
+
+
+template <typename D>
+py::dict latency_summary(const RS::LatencyRecorder<D>& recorder){
+    /* {"push": {...}, "pop": {...}, "compute": {...}}, latencies in nanoseconds. */
+    const char* op_names[RS::LatencyRecorder<D>::NUM_OPS] = {"push", "pop", "compute"};
+    py::dict d;
+    for (int op = 0; op != RS::LatencyRecorder<D>::NUM_OPS; ++op) {
+        const RS::LatencyHistogram& histogram = recorder.histogram(static_cast<typename RS::LatencyRecorder<D>::Op>(op));
+        py::dict summary;
+        summary["count"] = histogram.count();
+        summary["mean"] = histogram.mean();
+        summary["min"] = histogram.min();
+        summary["p50"] = histogram.percentile(0.5);
+        summary["p99"] = histogram.percentile(0.99);
+        summary["p999"] = histogram.percentile(0.999);
+        summary["max"] = histogram.max();
+        summary["buckets"] = histogram.buckets();
+        d[op_names[op]] = summary;
+    }
+    return d;
+}
+
+
+template <class Class>
+py::bytes serialize(const Class& rs){
+    return py::bytes(rs.serialize());
+}
+
+
+template <class Class>
+void deserialize(Class& rs, const py::bytes& data){
+    rs.deserialize(std::string(data));
+}
+
+
+template <class Class>
+Class unpickle(Class rs, const py::bytes& data){
+    /* rs is a default constructed instance, its settings are overwritten by the checkpoint. */
+    rs.deserialize(std::string(data));
+    return rs;
 }
 
 
@@ -35,7 +225,12 @@ void declare_array_RollingStatistics(py::module& m, const std::string& typestr)
         .def("front", &Class::front)
         .def("push", &Class::push, py::arg("val"))
         .def("pop", &Class::pop)
-        .def("compute", &Class::compute);
+        .def("compute", &Class::compute)
+        .def("serialize", &serialize<Class>)
+        .def("deserialize", &deserialize<Class>, py::arg("data"))
+        .def("merge", [](Class& rs, const Class& other){ rs.merge(other); }, py::arg("other"))
+        .def("subtract", [](Class& rs, const Class& other){ rs.subtract(other); }, py::arg("other"))
+        .def(py::pickle(&serialize<Class>, [](const py::bytes& data){ return unpickle<Class>(Class(true), data); }));
 }
 
 
@@ -50,7 +245,10 @@ void declare_array_RollingRank(py::module& m, const std::string& typestr) {
         .def("front", &Class::front)
         .def("push", &Class::push, py::arg("val"))
         .def("pop", &Class::pop)
-        .def("compute", &Class::compute);
+        .def("compute", &Class::compute)
+        .def("serialize", &serialize<Class>)
+        .def("deserialize", &deserialize<Class>, py::arg("data"))
+        .def(py::pickle(&serialize<Class>, [](const py::bytes& data){ return unpickle<Class>(Class(true, false), data); }));
 }
 
 
@@ -66,20 +264,147 @@ void declare_array_RollingOrderStatistics(py::module& m, const std::string& type
         .def("front", &Class::front)
         .def("push", &Class::push, py::arg("val"))
         .def("pop", &Class::pop)
+        .def("compute", &Class::compute)
+        .def("serialize", &serialize<Class>)
+        .def("deserialize", &deserialize<Class>, py::arg("data"))
+        .def(py::pickle(&serialize<Class>, [](const py::bytes& data){ return unpickle<Class>(Class(0, true, false), data); }));
+}
+
+
+
+template <typename D, class Class>
+void declare_array_RollingStreak(py::module& m, const std::string& typestr) {
+    std::string pyclass_name = Class::name + std::string("_") + typestr;
+    py::class_<Class, RS::RollingStatistics<D>>(m, pyclass_name.c_str())
+        .def(py::init<D, bool>(), py::arg("threshold")=0, py::arg("skip_nan")=true)
+        .def_readwrite("threshold", &Class::threshold)
+        .def("clear", &Class::clear)
+        .def("size_nan", &Class::size_nan)
+        .def("size_notnan", &Class::size_notnan)
+        .def("front", &Class::front)
+        .def("push", &Class::push, py::arg("val"))
+        .def("pop", &Class::pop)
+        .def("compute", &Class::compute)
+        .def("serialize", &serialize<Class>)
+        .def("deserialize", &deserialize<Class>, py::arg("data"))
+        .def(py::pickle(&serialize<Class>, [](const py::bytes& data){ return unpickle<Class>(Class(0, true), data); }));
+}
+
+
+template <typename D, class Class>
+void declare_array_RollingCountAbove(py::module& m, const std::string& typestr) {
+    std::string pyclass_name = Class::name + std::string("_") + typestr;
+    py::class_<Class, RS::RollingStatistics<D>>(m, pyclass_name.c_str())
+        .def(py::init<D, bool, bool>(), py::arg("threshold"), py::arg("skip_nan")=true, py::arg("dynamic")=false)
+        .def_property("threshold", &Class::get_threshold, &Class::set_threshold)
+        .def("clear", &Class::clear)
+        .def("size_nan", &Class::size_nan)
+        .def("size_notnan", &Class::size_notnan)
+        .def("front", &Class::front)
+        .def("push", &Class::push, py::arg("val"))
+        .def("pop", &Class::pop)
+        .def("compute", &Class::compute)
+        .def("serialize", &serialize<Class>)
+        .def("deserialize", &deserialize<Class>, py::arg("data"))
+        .def(py::pickle(&serialize<Class>, [](const py::bytes& data){ return unpickle<Class>(Class(0, true, false), data); }));
+}
+
+
+template <typename D, class Class>
+void declare_array_RollingEntropy(py::module& m, const std::string& typestr) {
+    std::string pyclass_name = Class::name + std::string("_") + typestr;
+    py::class_<Class, RS::RollingStatistics<D>>(m, pyclass_name.c_str())
+        .def(py::init<size_t, D, D, bool, bool>(), py::arg("num_bins"), py::arg("lower"), py::arg("upper"), py::arg("skip_nan")=true, py::arg("normalize")=false)
+        .def("histogram", &Class::histogram)
+        .def("clear", &Class::clear)
+        .def("size_nan", &Class::size_nan)
+        .def("size_notnan", &Class::size_notnan)
+        .def("front", &Class::front)
+        .def("push", &Class::push, py::arg("val"))
+        .def("pop", &Class::pop)
+        .def("compute", &Class::compute)
+        .def("serialize", &serialize<Class>)
+        .def("deserialize", &deserialize<Class>, py::arg("data"))
+        .def("merge", &Class::merge, py::arg("other"))
+        .def("subtract", &Class::subtract, py::arg("other"))
+        .def(py::pickle(&serialize<Class>, [](const py::bytes& data){ return unpickle<Class>(Class(1, 0, 1, true, false), data); }));
+}
+
+
+template <typename T, class Class>
+void declare_array_RollingBitStatistics(py::module& m, const std::string& typestr) {
+    std::string pyclass_name = Class::name + std::string("_") + typestr;
+    py::class_<Class, RS::RollingBitStatistics<T>>(m, pyclass_name.c_str())
+        .def(py::init<>())
+        .def("clear", &Class::clear)
+        .def("size", &Class::size)
+        .def("front", &Class::front)
+        .def("push", &Class::push, py::arg("val"))
+        .def("pop", &Class::pop)
         .def("compute", &Class::compute);
 }
 
 
+template <typename D>
+void declare_LatencyRecorder(py::module& m, const std::string& typestr) {
+    /* keeps the accumulator alive as long as the recorder. */
+    std::string pyclass_name = std::string("LatencyRecorder_") + typestr;
+    py::class_<RS::LatencyRecorder<D>>(m, pyclass_name.c_str())
+        .def(py::init<RS::RollingStatistics<D>&, size_t>(), py::arg("rs"), py::arg("sample_every")=1, py::keep_alive<1, 2>())
+        .def("push", &RS::LatencyRecorder<D>::push, py::arg("val"))
+        .def("pop", &RS::LatencyRecorder<D>::pop)
+        .def("compute", &RS::LatencyRecorder<D>::compute)
+        .def("clear", &RS::LatencyRecorder<D>::clear)
+        .def("summary", &latency_summary<D>);
+}
+
+
+template <typename D>
+void declare_Snapshot(py::module& m, const std::string& typestr) {
+    std::string pyclass_name = std::string("Snapshot_") + typestr;
+    py::class_<RS::Snapshot<D>>(m, pyclass_name.c_str())
+        .def_readonly("value", &RS::Snapshot<D>::value)
+        .def_readonly("size_nan", &RS::Snapshot<D>::size_nan)
+        .def_readonly("size_notnan", &RS::Snapshot<D>::size_notnan)
+        .def_readonly("version", &RS::Snapshot<D>::version);
+#ifdef RS_HAS_POSIX_SHM
+    pyclass_name = std::string("ShmPublisher_") + typestr;
+    py::class_<RS::ShmPublisher<D>>(m, pyclass_name.c_str())
+        .def(py::init<const std::string&, size_t>(), py::arg("name"), py::arg("num_slots"))
+        .def("num_slots", &RS::ShmPublisher<D>::num_slots)
+        .def("publish", &RS::ShmPublisher<D>::publish, py::arg("slot"), py::arg("rs"))
+        .def("unlink", &RS::ShmPublisher<D>::unlink);
+    pyclass_name = std::string("ShmReader_") + typestr;
+    py::class_<RS::ShmReader<D>>(m, pyclass_name.c_str())
+        .def(py::init<const std::string&>(), py::arg("name"))
+        .def("num_slots", &RS::ShmReader<D>::num_slots)
+        .def("load", &RS::ShmReader<D>::load, py::arg("slot"));
+#endif
+}
+
+
 
 PYBIND11_MODULE(rolling_statistics_py, m) {
     // we will only provide float types because NAN cannot be cast to int.
-    m.def("roll_ndarray_float", &roll_ndarray<float>, py::arg("arr"), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"));
-    m.def("roll_ndarray_double", &roll_ndarray<double>, py::arg("arr"), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"));
+    m.def("roll_ndarray_float", &roll_ndarray<float>, py::arg("arr").noconvert(), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"), py::arg("num_threads")=1, py::arg("deterministic")=false);
+    m.def("roll_ndarray_double", &roll_ndarray<double>, py::arg("arr").noconvert(), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"), py::arg("num_threads")=1, py::arg("deterministic")=false);
+    m.def("first_touch_float", &first_touch<float>, py::arg("arr").noconvert(), py::arg("num_threads"));
+    m.def("first_touch_double", &first_touch<double>, py::arg("arr").noconvert(), py::arg("num_threads"));
 
     // declare base class - this simply exposes it to Python, it's impossible to
     // construct a BaseClass_float in Python since no constructor is provided
-    py::class_<RS::RollingStatistics<float>>(m, "RollingStatistics_float");
-    py::class_<RS::RollingStatistics<double>>(m, "RollingStatistics_double");
+    py::class_<RS::RollingStatistics<float>>(m, "RollingStatistics_float")
+        .def("instrumentation", &instrumentation<float>)
+        .def("reset_instrumentation", &RS::RollingStatistics<float>::reset_instrumentation)
+        .def("memory_usage", &memory_usage<RS::RollingStatistics<float>>);
+    py::class_<RS::RollingStatistics<double>>(m, "RollingStatistics_double")
+        .def("instrumentation", &instrumentation<double>)
+        .def("reset_instrumentation", &RS::RollingStatistics<double>::reset_instrumentation)
+        .def("memory_usage", &memory_usage<RS::RollingStatistics<double>>);
+    m.attr("INSTRUMENTATION_ENABLED") = RS::INSTRUMENTATION_ENABLED;
+    m.def("detected_simd_level", []() { return std::string(RS::simd_level_name(RS::detected_simd_level())); });
+    m.def("simd_level", []() { return std::string(RS::simd_level_name(RS::simd_level())); });
+    m.def("set_simd_level", [](const std::string& level) { RS::set_simd_level(RS::parse_simd_level(level)); }, py::arg("level"));
 
     declare_array_RollingStatistics<float, RS::RollingMean<float>>(m, std::string("float"));
     declare_array_RollingStatistics<double, RS::RollingMean<double>>(m, std::string("double"));
@@ -97,4 +422,52 @@ PYBIND11_MODULE(rolling_statistics_py, m) {
     declare_array_RollingRank<double, RS::RollingRank<double>>(m, std::string("double"));
     declare_array_RollingOrderStatistics<float, RS::RollingOrderStatistics<float>>(m, std::string("float"));
     declare_array_RollingOrderStatistics<double, RS::RollingOrderStatistics<double>>(m, std::string("double"));
+    declare_array_RollingStreak<float, RS::RollingStreak<float>>(m, std::string("float"));
+    declare_array_RollingStreak<double, RS::RollingStreak<double>>(m, std::string("double"));
+    declare_array_RollingStreak<float, RS::RollingMaxStreak<float>>(m, std::string("float"));
+    declare_array_RollingStreak<double, RS::RollingMaxStreak<double>>(m, std::string("double"));
+    declare_array_RollingCountAbove<float, RS::RollingCountAbove<float>>(m, std::string("float"));
+    declare_array_RollingCountAbove<double, RS::RollingCountAbove<double>>(m, std::string("double"));
+    declare_array_RollingCountAbove<float, RS::RollingFractionAbove<float>>(m, std::string("float"));
+    declare_array_RollingCountAbove<double, RS::RollingFractionAbove<double>>(m, std::string("double"));
+    declare_array_RollingEntropy<float, RS::RollingEntropy<float>>(m, std::string("float"));
+    declare_array_RollingEntropy<double, RS::RollingEntropy<double>>(m, std::string("double"));
+
+    py::class_<RS::RollingBitStatistics<bool>>(m, "RollingBitStatistics_bool")
+        .def("memory_usage", &memory_usage<RS::RollingBitStatistics<bool>>);
+    py::class_<RS::RollingBitStatistics<uint8_t>>(m, "RollingBitStatistics_uint8")
+        .def("memory_usage", &memory_usage<RS::RollingBitStatistics<uint8_t>>);
+    declare_array_RollingBitStatistics<bool, RS::RollingBitCount<bool>>(m, std::string("bool"));
+    declare_array_RollingBitStatistics<uint8_t, RS::RollingBitCount<uint8_t>>(m, std::string("uint8"));
+    declare_array_RollingBitStatistics<bool, RS::RollingBitSum<bool>>(m, std::string("bool"));
+    declare_array_RollingBitStatistics<uint8_t, RS::RollingBitSum<uint8_t>>(m, std::string("uint8"));
+    declare_array_RollingBitStatistics<bool, RS::RollingBitMean<bool>>(m, std::string("bool"));
+    declare_array_RollingBitStatistics<uint8_t, RS::RollingBitMean<uint8_t>>(m, std::string("uint8"));
+    m.def("roll_ndarray_bool", &roll_ndarray_bits<bool>, py::arg("arr").noconvert(), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"));
+    m.def("roll_ndarray_uint8", &roll_ndarray_bits<uint8_t>, py::arg("arr").noconvert(), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"));
+
+    declare_LatencyRecorder<float>(m, std::string("float"));
+    declare_LatencyRecorder<double>(m, std::string("double"));
+
+    declare_Snapshot<float>(m, std::string("float"));
+    declare_Snapshot<double>(m, std::string("double"));
+
+    // dtype-generic entry points. they never convert an array, a dtype mismatch raises TypeError.
+    m.def("roll_ndarray", &roll_ndarray_any, py::arg("arr").noconvert(), py::arg("rs"), py::arg("axis"), py::arg("window"), py::arg("min_periods"), py::arg("num_threads")=1, py::arg("deterministic")=false);
+    m.def("first_touch", &first_touch_any, py::arg("arr").noconvert(), py::arg("num_threads"));
+    for (const char* name : {"RollingMean", "RollingVariance", "RollingSkewness", "RollingZScore", "RollingMax", "RollingMin", "RollingRank",
+                             "RollingOrderStatistics", "RollingStreak", "RollingMaxStreak", "RollingCountAbove", "RollingFractionAbove", "RollingEntropy"}) {
+        declare_dtype_factory(m, name, "float64", false);
+    }
+    for (const char* name : {"RollingBitCount", "RollingBitSum", "RollingBitMean"}) {
+        declare_dtype_factory(m, name, "bool", true);
+    }
+    std::string module_name = py::str(m.attr("__name__"));
+    m.def("LatencyRecorder", [module_name](const py::object& rs, size_t sample_every) {
+        /* the recorder of rs's dtype, which keeps rs alive. */
+        const char* cls = py::isinstance<RS::RollingStatistics<float>>(rs) ? "LatencyRecorder_float" :
+                          py::isinstance<RS::RollingStatistics<double>>(rs) ? "LatencyRecorder_double" : nullptr;
+        if (cls == nullptr) { throw py::type_error("LatencyRecorder: rs must be a float or double rolling statistic, got " + type_name(rs)); }
+        return py::module::import(module_name.c_str()).attr(cls)(rs, sample_every);
+    }, py::arg("rs"), py::arg("sample_every")=1);
 }
@@ -6,14 +6,48 @@ from pybind11.setup_helpers import Pybind11Extension
 from setuptools import setup
 import os
 import shutil
+import sys
 
 
+def tuning_args():
+    """
+    compile and link flags from the environment, as the CMake options of the same names:
+    RS_NATIVE_ARCH=1 (-march=native), RS_LTO=1, and RS_PGO=generate or use with the profiles in RS_PGO_DIR.
+    PGO: build with RS_PGO=generate, run benchmark/benchmark_python.py, then rebuild with RS_PGO=use.
+    """
+    if sys.platform == 'win32':
+        return [], []
+    compile_args, link_args = [], []
+    if os.environ.get('RS_NATIVE_ARCH'):
+        compile_args += ['-march=native', '-ffp-contract=off']  # keeps results bitwise identical to a portable build
+    if os.environ.get('RS_LTO'):
+        compile_args.append('-flto')
+        link_args.append('-flto')
+    pgo = os.environ.get('RS_PGO', '').lower()
+    pgo_dir = os.path.abspath(os.environ.get('RS_PGO_DIR', 'pgo'))
+    if pgo == 'generate':
+        compile_args += ['-fprofile-generate=' + pgo_dir, '-fprofile-update=atomic']
+        link_args.append('-fprofile-generate=' + pgo_dir)
+    elif pgo == 'use':
+        compile_args += ['-fprofile-use=' + pgo_dir, '-fprofile-correction', '-Wno-missing-profile']
+    elif pgo:
+        raise ValueError('RS_PGO must be generate or use')
+    return compile_args, link_args
+
+
+tuning_compile_args, tuning_link_args = tuning_args()
+
 ext_modules = [
     Pybind11Extension(
         'rolling_statistics_py',
         sources=['rolling_statistics_py.cpp'],
         language='c++',
-        cxx_std=11
+        cxx_std=11,
+        libraries=['rt'] if sys.platform.startswith('linux') else [],  # shm_open lives in librt on older glibc
+        extra_compile_args=([] if sys.platform == 'win32' else ['-pthread']) + tuning_compile_args,  # parallel roll_ndarray uses std::thread
+        extra_link_args=([] if sys.platform == 'win32' else ['-pthread']) + tuning_link_args,
+        # RS_ENABLE_INSTRUMENTATION=1 python setup.py install compiles in the instrumentation counters
+        define_macros=[('RS_ENABLE_INSTRUMENTATION', None)] if os.environ.get('RS_ENABLE_INSTRUMENTATION') else []
     ),
 ]
 
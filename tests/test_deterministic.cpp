@@ -0,0 +1,82 @@
+/*
+ * regression test for roll_ndarray(..., deterministic=true): the results must be bitwise identical on any number
+ * of threads, including 1, for long single series (which are cut into chunks) and for 2-d arrays along both axes.
+ * every path also leaves the window of the object empty.
+ * exits with 1 and prints the first differing cell on failure.
+ * */
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "rolling_statistics.hpp"
+
+
+std::vector<double> make_series(size_t n, unsigned seed) {
+    /* a slowly varying signal plus noise and some NaN, so chunked sums accumulate rounding differently. */
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<double> vals(n);
+    for (size_t i = 0; i != n; ++i) {
+        vals[i] = gen() % 97 == 0 ? NAN : 1e3 * std::sin(1e-4 * static_cast<double>(i)) + noise(gen);
+    }
+    return vals;
+}
+
+
+int check(const RS::RollingStatistics<double>& prototype, const std::vector<double>& input, const std::vector<size_t>& shape,
+          size_t axis, size_t window, size_t min_periods) {
+    /* rolls input on 1 thread and on several, returns the number of mismatching runs. */
+    std::vector<double> expected = input;
+    prototype.clone()->roll_ndarray(expected.data(), shape, axis, window, min_periods, {}, 1, true);
+    int failures = 0;
+    for (size_t num_threads : {2, 3, 8, 0}) {
+        std::vector<double> result = input;
+        std::unique_ptr<RS::RollingStatistics<double>> rs = prototype.clone();
+        rs->push(1.0);
+        rs->roll_ndarray(result.data(), shape, axis, window, min_periods, {}, num_threads, true);
+        if (rs->size() != 0) {
+            std::printf("FAIL %s axis=%zu num_threads=%zu: the window is not empty after roll_ndarray()\n",
+                        prototype.class_name().c_str(), axis, num_threads);
+            ++failures;
+        }
+        if (std::memcmp(expected.data(), result.data(), expected.size() * sizeof(double)) != 0) {
+            size_t cell = 0;
+            while (std::memcmp(&expected[cell], &result[cell], sizeof(double)) == 0) { ++cell; }
+            std::printf("FAIL %s axis=%zu window=%zu num_threads=%zu: cell %zu is %.17g on 1 thread, %.17g\n",
+                        prototype.class_name().c_str(), axis, window, num_threads, cell, expected[cell], result[cell]);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+
+int main() {
+    std::vector<std::unique_ptr<RS::RollingStatistics<double>>> classes;
+    classes.emplace_back(new RS::RollingMean<double>());
+    classes.emplace_back(new RS::RollingVariance<double>());
+    classes.emplace_back(new RS::RollingSkewness<double>());
+    classes.emplace_back(new RS::RollingZScore<double>());
+    classes.emplace_back(new RS::RollingMax<double>());
+    classes.emplace_back(new RS::RollingRank<double>());
+
+    int failures = 0;
+    size_t num_checks = 0;
+    // one long series, cut into chunks of max(65536, 16 * window)
+    std::vector<double> series = make_series(300000, 1);
+    // a (T, N) panel, rolled along time (neighbouring lanes are neighbours in memory) and across it
+    std::vector<double> panel = make_series(20000 * 8, 2);
+    for (size_t c = 0; c != classes.size(); ++c) {
+        for (size_t window : {10, 1000}) {
+            failures += check(*classes[c], series, {series.size()}, 0, window, window / 2);
+            failures += check(*classes[c], panel, {20000, 8}, 0, window, window / 2);
+            failures += check(*classes[c], panel, {20000, 8}, 1, 5, 3);
+            num_checks += 3;
+        }
+    }
+    std::printf("%zu checks, %d failures\n", num_checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * regression test for values at and beyond the ends of the real line: +-inf and values far outside the range of
+ * RollingEntropy's bins must land in the first or last bin, so compute() matches a brute force entropy, and
+ * RollingCountAbove counts values strictly above its threshold, +-inf included, whether dynamic or not.
+ * exits with 1 on failure.
+ * */
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <random>
+#include <vector>
+#include "rolling_statistics.hpp"
+
+
+template <typename D>
+D pick(std::mt19937& gen) {
+    /* a mix of infinities, huge, ordinary and NaN values. */
+    const D inf = std::numeric_limits<D>::infinity();
+    const D vals[] = {inf, -inf, static_cast<D>(1e30), static_cast<D>(-1e30), std::numeric_limits<D>::max(),
+                      -std::numeric_limits<D>::max(), static_cast<D>(NAN)};
+    size_t i = gen() % 16;
+    if (i < sizeof(vals) / sizeof(vals[0])) { return vals[i]; }
+    return static_cast<D>(std::uniform_real_distribution<double>(-0.5, 1.5)(gen));
+}
+
+
+template <typename D>
+double brute_force_entropy(const std::deque<D>& window, size_t num_bins, double lower, double upper) {
+    std::vector<size_t> counts(num_bins, 0);
+    size_t n = 0;
+    for (size_t i = 0; i != window.size(); ++i) {
+        double val = static_cast<double>(window[i]);
+        if (std::isnan(val)) { continue; }
+        size_t b = 0;
+        if (val >= upper) { b = num_bins - 1; }
+        else if (val > lower) { b = std::min(num_bins - 1, static_cast<size_t>(std::floor((val - lower) / (upper - lower) * num_bins))); }
+        ++counts[b];
+        ++n;
+    }
+    double entropy = 0;
+    for (size_t b = 0; b != num_bins; ++b) {
+        if (counts[b] > 0) {
+            double p = static_cast<double>(counts[b]) / static_cast<double>(n);
+            entropy -= p * std::log(p);
+        }
+    }
+    return entropy;
+}
+
+
+template <typename D>
+int check_entropy(const char* type) {
+    int failures = 0;
+    const D inf = std::numeric_limits<D>::infinity();
+    RS::RollingEntropy<D> rs(4, 0, 1);
+    for (D val : {static_cast<D>(1e30), inf, -inf, static_cast<D>(0.99)}) { rs.push(val); }
+    const std::vector<size_t>& histogram = rs.histogram();
+    if (histogram != std::vector<size_t>({1, 0, 0, 3})) {
+        std::printf("FAIL RollingEntropy<%s>: histogram of 1e30, inf, -inf, 0.99 is %zu %zu %zu %zu, not 1 0 0 3\n",
+                    type, histogram[0], histogram[1], histogram[2], histogram[3]);
+        ++failures;
+    }
+
+    std::mt19937 gen(1);
+    RS::RollingEntropy<D> rolling(8, -0.25, 1.25);
+    std::deque<D> window;
+    for (size_t i = 0; i != 20000; ++i) {
+        D val = pick<D>(gen);
+        rolling.push(val);
+        window.push_back(val);
+        if (window.size() > 50) {
+            rolling.pop();
+            window.pop_front();
+        }
+        if (rolling.size_notnan() == 0) { continue; }
+        double expected = brute_force_entropy(window, 8, -0.25, 1.25);
+        double result = static_cast<double>(rolling.compute());
+        if (!(std::fabs(result - expected) <= 1e-5)) {
+            std::printf("FAIL RollingEntropy<%s>: step %zu gives %.17g, brute force %.17g\n", type, i, result, expected);
+            ++failures;
+            break;
+        }
+    }
+    return failures;
+}
+
+
+template <typename D>
+int check_count_above(const char* type) {
+    int failures = 0;
+    const D inf = std::numeric_limits<D>::infinity();
+    for (D threshold : {inf, -inf, std::numeric_limits<D>::max(), static_cast<D>(1e30), static_cast<D>(0.5)}) {
+        std::mt19937 gen(2);
+        RS::RollingCountAbove<D> fixed(threshold, true, false);
+        RS::RollingCountAbove<D> dynamic(threshold, true, true);
+        std::deque<D> window;
+        for (size_t i = 0; i != 5000; ++i) {
+            D val = pick<D>(gen);
+            fixed.push(val);
+            dynamic.push(val);
+            window.push_back(val);
+            if (window.size() > 30) {
+                fixed.pop();
+                dynamic.pop();
+                window.pop_front();
+            }
+            if (fixed.size_notnan() == 0) { continue; }
+            size_t expected = 0;
+            for (size_t j = 0; j != window.size(); ++j) { expected += window[j] > threshold; }
+            D result_fixed = fixed.compute();
+            D result_dynamic = dynamic.compute();
+            if (result_fixed != static_cast<D>(expected) || result_dynamic != static_cast<D>(expected)) {
+                std::printf("FAIL RollingCountAbove<%s> threshold=%g: step %zu counts %g fixed, %g dynamic, %zu brute force\n",
+                            type, static_cast<double>(threshold), i, static_cast<double>(result_fixed),
+                            static_cast<double>(result_dynamic), expected);
+                ++failures;
+                break;
+            }
+        }
+    }
+    return failures;
+}
+
+
+int main() {
+    int failures = 0;
+    failures += check_entropy<float>("float");
+    failures += check_entropy<double>("double");
+    failures += check_count_above<float>("float");
+    failures += check_count_above<double>("double");
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 /* Some simple examples to showcase the use of rolling_statistics in C++. */
 
 #include <iostream>
+#include <cstring>
 #include "src/rolling_statistics.hpp"
 
 int main() {
@@ -45,6 +46,18 @@ int main() {
      * 2.5  3.5  1.5
      * 0    3.75 nan
      */
+
+    // example for parallel rolling of a single long series. with deterministic=true, the results are bitwise
+    // identical whatever the number of threads, e.g. for reproducible backtests.
+    std::vector<double> series(1000000), series_copy;
+    for (size_t i = 0; i != series.size(); ++i) { series[i] = std::sin(0.001 * i) + 0.01 * (i % 7); }
+    series_copy = series;
+    RS::RollingVariance<double> rolling_variance;
+    const std::vector<size_t> shape_series = {series.size()};
+    rolling_variance.roll_ndarray(series.data(), shape_series, 0, 100, 50, {}, 1, true);
+    rolling_variance.roll_ndarray(series_copy.data(), shape_series, 0, 100, 50, {}, 8, true);
+    bool identical = std::memcmp(series.data(), series_copy.data(), series.size() * sizeof(double)) == 0;
+    std::cout << "identical on 1 and 8 threads: " << identical << std::endl;  // 1
     system("pause");
     return 0;
 }
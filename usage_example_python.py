@@ -7,14 +7,14 @@ import rolling_statistics_py as rsp
 
 # unstructured data, work exactly the same as in C++.
 
-# structured example 1: same array as C++, but we now use a wrapper function roll_ndarray_float().
+# structured example 1: same array as C++, but we now use a wrapper function roll_ndarray().
 arr = np.array([[2.0, 3.0, 1.0],
                [3.0, 3.5, np.nan],
                [np.nan, 4.0, 2.0],
                [-3.0, np.nan, np.nan]], dtype='float32')
-rolling_mean = rsp.RollingMean_float()
+rolling_mean = rsp.RollingMean(dtype=arr.dtype)  # a RollingMean_float
 
-rsp.roll_ndarray_float(arr, rolling_mean, axis=0, window=3, min_periods=2)
+rsp.roll_ndarray(arr, rolling_mean, axis=0, window=3, min_periods=2)
 print(arr)  # same result as C++.
 
 # structured exmaple 2: